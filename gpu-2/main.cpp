@@ -3,6 +3,12 @@
 #include <iostream>
 #include <string>
 #include <numeric>
+#include <map>
+#include <cmath>
+#include <array>
+#include <fstream>
+#include <algorithm>
+#include <limits>
 
 void print_info() {
     std::vector<sycl::platform> platforms = sycl::platform::get_platforms();
@@ -16,96 +22,529 @@ void print_info() {
     std::cout << std::endl;
 }
 
-std::pair<int, std::string> parse_args(int argc, char* argv[]) {
-    int N;
+struct Args {
+    int N = 0;
     std::string device;
+    std::string integrand = "sincos";
+    std::map<std::string, std::string> options;
+};
+
+// app.exe N device [integrand] [key=value ...]
+Args parse_args(int argc, char* argv[]) {
+    Args args;
     try {
         if (argc < 3) throw -1;
-        N = atoi(argv[1]);
-        if (N == 0) throw -1;
-        device = argv[2];
-        if (device != "cpu" && device != "gpu") {
+        args.N = atoi(argv[1]);
+        if (args.N == 0) throw -1;
+        args.device = argv[2];
+        if (args.device != "cpu" && args.device != "gpu") {
             throw -1;
         }
+        for (int i = 3; i < argc; i++) {
+            std::string arg = argv[i];
+            size_t eq = arg.find('=');
+            if (eq == std::string::npos) {
+                args.integrand = arg;
+            } else {
+                args.options[arg.substr(0, eq)] = arg.substr(eq + 1);
+            }
+        }
     } catch (...) {
         std::cout << "Args error" << std::endl;
         exit(-1);
     }
-    return std::pair<int, std::string>{N, device};
+    return args;
 }
 
-float analytical_solution(){
-    return 2 * sin(0.5) * sin(0.5) * sin(1);
+double get_option(const Args& args, const std::string& key, double default_value) {
+    auto it = args.options.find(key);
+    return it == args.options.end() ? default_value : std::stod(it->second);
 }
 
-void integral(int N, std::string device_type) {
-    const int group_count = 8;
-    const int group_size = 8;
-
-    sycl::queue queue;
+sycl::queue create_queue(std::string device_type) {
     if (device_type == "cpu") {
-        queue = sycl::queue(sycl::cpu_selector{}, {sycl::property::queue::enable_profiling()});
+        return sycl::queue(sycl::cpu_selector{}, {sycl::property::queue::enable_profiling()});
     } else if (device_type == "gpu") {
-        queue = sycl::queue(sycl::gpu_selector{}, {sycl::property::queue::enable_profiling()});
-    } else {
-        std::cout << "Selector error" << std::endl;
-        exit(-1);
+        return sycl::queue(sycl::gpu_selector{}, {sycl::property::queue::enable_profiling()});
+    }
+    std::cout << "Selector error" << std::endl;
+    exit(-1);
+}
+
+// Integrands over the unit cube [0, 1]^dims: dims is a compile-time constant and operator() is
+// inlined into the kernel, exact() is the analytical value
+struct SinCos {
+    static constexpr int dims = 2;
+    static const char* name() { return "sin(x) * cos(y)"; }
+    static double exact() { return 2 * sin(0.5) * sin(0.5) * sin(1); }
+    float operator()(const float* x) const {
+        return sycl::sin(x[0]) * sycl::cos(x[1]);
     }
+};
 
-    std::vector<float> group_results(group_count * group_count);
-    std::fill(group_results.begin(), group_results.end(), 0.0f);
-    const int interval_per_work_item = (float)(N / (group_count * group_size));
-    const float step = 1.0f / N;
-    uint64_t start_time, end_time = 0;
-    {
-        sycl::buffer<float> group_results_buff(group_results.data(), group_results.size());
+struct Gauss3D {
+    static constexpr int dims = 3;
+    static const char* name() { return "exp(-(x^2 + y^2 + z^2))"; }
+    static double exact() { return std::pow(std::sqrt(std::acos(-1.0)) / 2 * std::erf(1.0), 3); }
+    float operator()(const float* x) const {
+        return sycl::exp(-(x[0] * x[0] + x[1] * x[1] + x[2] * x[2]));
+    }
+};
+
+// Parameterized integrand for batches, every record has its own box [lo, hi] and coefficients
+struct SinCosSweep {
+    static constexpr int dims = 2;
+    static constexpr int params = 2;
+    static const char* name() { return "sin(a * x) * cos(b * y)"; }
+    static double exact(const float* lo, const float* hi, const float* p) {
+        return (cos(p[0] * lo[0]) - cos(p[0] * hi[0])) / p[0] * (sin(p[1] * hi[1]) - sin(p[1] * lo[1])) / p[1];
+    }
+    float operator()(const float* x, const float* p) const {
+        return sycl::sin(p[0] * x[0]) * sycl::cos(p[1] * x[1]);
+    }
+};
+
+template <int D, int P>
+struct IntegralRecord {
+    float lo[D];
+    float hi[D];
+    float params[P];
+};
+
+// Kahan-compensated running sum, keeps the per-work-item error independent of the number of points
+struct KahanSum {
+    float sum = 0.0f;
+    float c = 0.0f;
+    void add(float value) {
+        float y = value - c;
+        float t = sum + y;
+        c = (t - sum) - y;
+        sum = t;
+    }
+};
+
+// Base-N digits of a cell index of an N^D grid. A cursor is advanced by the digits of a fixed stride
+// with carries, so kernels walk the grid without 64-bit divisions
+template <int D>
+std::array<unsigned, D> grid_digits(uint64_t value, int N) {
+    std::array<unsigned, D> digits;
+    for (int d = 0; d < D; d++) {
+        digits[d] = value % N;
+        value /= N;
+    }
+    return digits;
+}
+
+template <int D>
+void grid_advance(std::array<unsigned, D>& index, const std::array<unsigned, D>& stride, int N) {
+    unsigned carry = 0;
+    for (int d = 0; d < D; d++) {
+        unsigned digit = index[d] + stride[d] + carry;
+        carry = digit >= (unsigned)N;
+        index[d] = carry ? digit - N : digit;
+    }
+}
+
+struct LaunchConfig {
+    int group_size = 0;
+    int groups_per_cu = 4;
+};
+
+// groups_per_cu work-groups per compute unit, group_size = 0 takes max_work_group_size (up to 1024)
+sycl::nd_range<1> device_range(const sycl::device& device, LaunchConfig config) {
+    size_t max_group_size = device.get_info<sycl::info::device::max_work_group_size>();
+    size_t group_size = std::min<size_t>(config.group_size > 0 ? config.group_size : 1024, max_group_size);
+    size_t group_count = device.get_info<sycl::info::device::max_compute_units>() * config.groups_per_cu;
+    return sycl::nd_range<1>(sycl::range<1>(group_count * group_size), sycl::range<1>(group_size));
+}
+
+// Cache file lines: device name, integrand and power-of-two bucket of N as the key, then
+// work-group size and work-groups per compute unit, all tab-separated
+std::string tuning_key(const std::string& device, const std::string& integrand, int N) {
+    int bucket = 1;
+    while (bucket < N) {
+        bucket *= 2;
+    }
+    return device + '\t' + integrand + '\t' + std::to_string(bucket);
+}
+
+std::map<std::string, LaunchConfig> load_tuning(const std::string& path) {
+    std::map<std::string, LaunchConfig> entries;
+    std::ifstream in(path);
+    std::string line;
+    while (std::getline(in, line)) {
+        size_t second = line.rfind('\t');
+        size_t first = second == std::string::npos || second == 0 ? std::string::npos : line.rfind('\t', second - 1);
+        if (first == std::string::npos) {
+            continue;
+        }
         try {
-            sycl::event event = queue.submit([&](sycl::handler& cgh) {
-                auto group_results_acc = group_results_buff.get_access<sycl::access::mode::write>(cgh);
-                cgh.parallel_for(sycl::nd_range<2>(sycl::range<2>(group_count*group_size, group_count*group_size), sycl::range<2>(group_size, group_size)), [=](sycl::nd_item<2> item) {
+            LaunchConfig config = {std::stoi(line.substr(first + 1)), std::stoi(line.substr(second + 1))};
+            entries[line.substr(0, first)] = config;
+        } catch (...) {
+            continue;
+        }
+    }
+    return entries;
+}
 
-                float begin_x = (float)(interval_per_work_item * item.get_global_id(0)) / (float)N;
-                float begin_y = (float)(interval_per_work_item * item.get_global_id(1)) / (float)N;
+void store_tuning(const std::string& path, const std::map<std::string, LaunchConfig>& entries) {
+    std::ofstream out(path);
+    for (const auto& entry : entries) {
+        out << entry.first << '\t' << entry.second.group_size << '\t' << entry.second.groups_per_cu << '\n';
+    }
+}
 
-                float end_x = begin_x + (float)interval_per_work_item * step;
-                float end_y = begin_y + (float)interval_per_work_item * step;
+// Midpoint rule with N points per dimension. The N^dims cells are spread over the work-items with a
+// grid stride, each cell centre is computed from its integer index, so there is no truncation of
+// N / work-items and no boundary counted twice
+template <typename F>
+sycl::event integrate(sycl::queue& queue, int N, sycl::nd_range<1> range, float* result) {
+    constexpr int D = F::dims;
+    uint64_t total = 1;
+    for (int d = 0; d < D; d++) {
+        total *= N;
+    }
+    const float step = 1.0f / N;
+    const float volume = std::pow(step, D);
+    std::array<unsigned, D> stride = grid_digits<D>(range.get_global_range()[0], N);
 
-                float work_item_res = 0.0f;
-                for (float x = begin_x; x <= end_x; x += step) {
-                    for (float y = begin_y; y <= end_y;  y += step) {
-                        work_item_res += sycl::sin((x + x + step) / 2.0f) * sycl::cos((y + y + step) / 2.0f) * step * step;
-                    }
+    return queue.submit([&](sycl::handler& cgh) {
+        cgh.parallel_for(range, sycl::reduction(result, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+            [=](sycl::nd_item<1> item, auto& sum) {
+            F f;
+            KahanSum work_item_res;
+            std::array<unsigned, D> index = grid_digits<D>(item.get_global_id(0), N);
+            float x[D];
+            for (uint64_t cell = item.get_global_id(0); cell < total; cell += item.get_global_range(0)) {
+                for (int d = 0; d < D; d++) {
+                    x[d] = ((float)index[d] + 0.5f) * step;
                 }
+                work_item_res.add(f(x));
+                grid_advance<D>(index, stride, N);
+            }
+            sum += work_item_res.sum * volume;
+        });
+    });
+}
 
+// Times integrate() for every work-group size and number of work-groups per compute unit and
+// returns the fastest launch
+template <typename F>
+LaunchConfig tune_integral(sycl::queue& queue, int N, float* result) {
+    int max_group_size = queue.get_device().get_info<sycl::info::device::max_work_group_size>();
+    LaunchConfig best;
+    uint64_t best_ns = UINT64_MAX;
+    for (int group_size : {32, 64, 128, 256, 512, 1024}) {
+        if (group_size > max_group_size) {
+            continue;
+        }
+        for (int groups_per_cu : {1, 2, 4, 8, 16}) {
+            LaunchConfig config = {group_size, groups_per_cu};
+            sycl::event event = integrate<F>(queue, N, device_range(queue.get_device(), config), result);
+            event.wait_and_throw();
+            uint64_t ns = event.get_profiling_info<sycl::info::event_profiling::command_end>() - event.get_profiling_info<sycl::info::event_profiling::command_start>();
+            std::cout << "Tune:\t\t\twg " << group_size << " x " << groups_per_cu << " per CU: " << ns / 1000 << " us" << std::endl;
+            if (ns < best_ns) {
+                best_ns = ns;
+                best = config;
+            }
+        }
+    }
+    return best;
+}
 
+// With a cache path the launch comes from the cache for this device, integrand and size bucket,
+// tuning first on a miss
+template <typename F>
+void integral(int N, std::string device_type, LaunchConfig config, std::string cache_path) {
+    constexpr int D = F::dims;
+    sycl::queue queue = create_queue(device_type);
+    float* result = sycl::malloc_shared<float>(1, queue);
+    uint64_t total = 1;
+    for (int d = 0; d < D; d++) {
+        total *= N;
+    }
 
-                float group_sum = sycl::reduce_over_group(item.get_group(), work_item_res, std::plus<float>());
-                if (item.get_local_id() == 0) {
-                    group_results_acc[item.get_group(0) + item.get_group(1)*group_count] = group_sum;
+    uint64_t start_time = 0, end_time = 0;
+    sycl::nd_range<1> range = device_range(queue.get_device(), config);
+    try {
+        if (!cache_path.empty()) {
+            std::string device_name = queue.get_device().get_info<sycl::info::device::name>();
+            std::map<std::string, LaunchConfig> entries = load_tuning(cache_path);
+            std::string key = tuning_key(device_name, F::name(), N);
+            if (entries.count(key)) {
+                config = entries[key];
+            } else {
+                config = tune_integral<F>(queue, N, result);
+                entries[key] = config;
+                store_tuning(cache_path, entries);
+            }
+            range = device_range(queue.get_device(), config);
+        }
+        sycl::event event = integrate<F>(queue, N, range, result);
+        queue.wait_and_throw();
+        start_time = event.get_profiling_info<sycl::info::event_profiling::command_start>();
+        end_time = event.get_profiling_info<sycl::info::event_profiling::command_end>();
+    } catch (sycl::exception &e) {
+        std::cout << e.what() << std::endl;
+    }
+    float computed = *result;
+    sycl::free(result, queue);
+
+    double kernel_s = (end_time - start_time) * 1e-9;
+    std::cout << "Integrand:\t\t" << F::name() << std::endl;
+    std::cout << "Number of rectangles:\t" << N << "^" << D << std::endl;
+    std::cout << "Target device:\t\t" << queue.get_device().get_info<sycl::info::device::name>() << std::endl;
+    std::cout << "Work-items:\t\t" << range.get_global_range()[0] << " (" << range.get_local_range()[0] << " per group)" << std::endl;
+    std::cout << "Kernel time:\t\t" << (end_time - start_time) / 1000000 << " ms" << std::endl;
+    std::cout << "Evaluations/s:\t\t" << (kernel_s > 0 ? total / kernel_s : 0.0) << std::endl;
+    std::cout << "Expected:\t\t" << F::exact() << std::endl;
+    std::cout << "Computed:\t\t" << computed << std::endl;
+    std::cout << "Difference:\t\t" << fabs(computed - F::exact()) << std::endl;
+}
+
+// Integrates every record with the N^dims midpoint rule in a single launch: dimension 0 of the
+// nd_range is the record, dimension 1 the quadrature points of that record, one work-group per
+// record reduces its points and writes one result
+template <typename F>
+std::vector<float> integral_batch(sycl::queue& queue, const std::vector<IntegralRecord<F::dims, F::params>>& records, int N, uint64_t& kernel_ns) {
+    constexpr int D = F::dims;
+    using Record = IntegralRecord<F::dims, F::params>;
+    size_t group_size = std::min<size_t>(queue.get_device().get_info<sycl::info::device::max_work_group_size>(), 256);
+    uint64_t total = 1;
+    for (int d = 0; d < D; d++) {
+        total *= N;
+    }
+    std::array<unsigned, D> stride = grid_digits<D>(group_size, N);
+
+    Record* records_device = sycl::malloc_device<Record>(records.size(), queue);
+    float* results_device = sycl::malloc_device<float>(records.size(), queue);
+    queue.memcpy(records_device, records.data(), records.size()*sizeof(Record)).wait();
+
+    sycl::event event = queue.submit([&](sycl::handler& cgh) {
+        cgh.parallel_for(sycl::nd_range<2>(sycl::range<2>(records.size(), group_size), sycl::range<2>(1, group_size)), [=](sycl::nd_item<2> item) {
+            F f;
+            const Record record = records_device[item.get_global_id(0)];
+            float step[D];
+            float volume = 1.0f;
+            for (int d = 0; d < D; d++) {
+                step[d] = (record.hi[d] - record.lo[d]) / N;
+                volume *= step[d];
+            }
+            KahanSum work_item_res;
+            std::array<unsigned, D> index = grid_digits<D>(item.get_local_id(1), N);
+            float x[D];
+            for (uint64_t cell = item.get_local_id(1); cell < total; cell += item.get_local_range(1)) {
+                for (int d = 0; d < D; d++) {
+                    x[d] = record.lo[d] + ((float)index[d] + 0.5f) * step[d];
                 }
-                    
+                work_item_res.add(f(x, record.params));
+                grid_advance<D>(index, stride, N);
+            }
+            float record_sum = sycl::reduce_over_group(item.get_group(), work_item_res.sum, std::plus<float>());
+            if (item.get_local_id(1) == 0) {
+                results_device[item.get_global_id(0)] = record_sum * volume;
+            }
+        });
+    });
+    event.wait_and_throw();
+    kernel_ns = event.get_profiling_info<sycl::info::event_profiling::command_end>() - event.get_profiling_info<sycl::info::event_profiling::command_start>();
+
+    std::vector<float> results(records.size());
+    queue.memcpy(results.data(), results_device, records.size()*sizeof(float)).wait();
+    sycl::free(records_device, queue);
+    sycl::free(results_device, queue);
+    return results;
+}
+
+// Parameter sweep of batch_size integrals of sin(a x) cos(b y) over boxes of growing height
+void batch_integral(int N, std::string device_type, int batch_size) {
+    using Record = IntegralRecord<SinCosSweep::dims, SinCosSweep::params>;
+    sycl::queue queue = create_queue(device_type);
+
+    std::vector<Record> records(batch_size);
+    for (int k = 0; k < batch_size; k++) {
+        float t = (float)k / batch_size;
+        records[k] = {{0.0f, 0.0f}, {1.0f, 0.5f + 0.5f * t}, {1.0f + 3.0f * t, 4.0f - 3.0f * t}};
+    }
+
+    uint64_t kernel_ns = 0;
+    std::vector<float> results;
+    try {
+        results = integral_batch<SinCosSweep>(queue, records, N, kernel_ns);
+    } catch (sycl::exception &e) {
+        std::cout << e.what() << std::endl;
+        return;
+    }
+
+    double max_difference = 0.0;
+    for (int k = 0; k < batch_size; k++) {
+        max_difference = std::max(max_difference, fabs(results[k] - SinCosSweep::exact(records[k].lo, records[k].hi, records[k].params)));
+    }
+    double evaluations = (double)batch_size * std::pow((double)N, SinCosSweep::dims);
+    std::cout << "Integrand:\t\t" << SinCosSweep::name() << std::endl;
+    std::cout << "Integrals:\t\t" << batch_size << std::endl;
+    std::cout << "Number of rectangles:\t" << N << "^" << SinCosSweep::dims << " per integral" << std::endl;
+    std::cout << "Target device:\t\t" << queue.get_device().get_info<sycl::info::device::name>() << std::endl;
+    std::cout << "Kernel time:\t\t" << kernel_ns / 1000000 << " ms (" << kernel_ns / 1000.0 / batch_size << " us per integral)" << std::endl;
+    std::cout << "Evaluations/s:\t\t" << (kernel_ns > 0 ? evaluations / (kernel_ns * 1e-9) : 0.0) << std::endl;
+    std::cout << "Max difference:\t\t" << max_difference << std::endl;
+}
+
+template <int D>
+struct Cell {
+    float lo[D];
+    float h;
+};
+
+// Adaptive cubature over cubic cells, starting from an N^dims grid. Every wave evaluates the current
+// cells with the 2^dims-point Gauss-Legendre rule and the embedded midpoint rule, cells whose estimate
+// |gauss - midpoint| is within tolerance * volume are added to the result, the others are split into
+// 2^dims children appended to the next wave's queue with an atomic counter. When the queue is full
+// a failing cell is accepted as is. The estimate is the error of the midpoint rule, so it is a
+// conservative bound for the Gauss result that is accumulated
+template <typename F>
+void adaptive_integral(int N, std::string device_type, float tolerance, unsigned capacity) {
+    constexpr int D = F::dims;
+    constexpr unsigned children = 1 << D;
+    const float gauss_offset = 0.5f / std::sqrt(3.0f);
+    const float min_size = 1e-6f;
+    sycl::queue queue = create_queue(device_type);
+
+    // every cell of a wave may add children to the 32-bit queue counter
+    const uint64_t max_capacity = std::numeric_limits<unsigned>::max() / (2 * children);
+    uint64_t initial_count = 1;
+    for (int d = 0; d < D; d++) {
+        initial_count *= N;
+    }
+    if (initial_count > max_capacity) {
+        std::cout << "Initial grid is too large for the cell queue" << std::endl;
+        return;
+    }
+    std::vector<Cell<D>> initial;
+    initial.reserve(initial_count);
+    for (uint64_t cell = 0; cell < initial_count; cell++) {
+        Cell<D> c;
+        uint64_t rest = cell;
+        for (int d = 0; d < D; d++) {
+            c.lo[d] = (float)(rest % N) / N;
+            rest /= N;
+        }
+        c.h = 1.0f / N;
+        initial.push_back(c);
+    }
+    // whole groups of children fit, and never fewer cells than the initial grid
+    uint64_t queue_size = std::min<uint64_t>(std::max<uint64_t>(capacity, initial_count), max_capacity);
+    queue_size += (children - queue_size % children) % children;
+    capacity = queue_size;
+
+    Cell<D>* cells_in = sycl::malloc_device<Cell<D>>(capacity, queue);
+    Cell<D>* cells_out = sycl::malloc_device<Cell<D>>(capacity, queue);
+    unsigned* out_count = sycl::malloc_shared<unsigned>(1, queue);
+    float* wave_sums = sycl::malloc_shared<float>(2, queue);
+    queue.memcpy(cells_in, initial.data(), initial.size()*sizeof(Cell<D>)).wait();
+
+    unsigned count = initial.size();
+    double result = 0.0, error = 0.0;
+    uint64_t evaluations = 0, kernel_ns = 0;
+    int waves = 0;
+    try {
+        while (count > 0) {
+            *out_count = 0;
+            sycl::event event = queue.submit([&](sycl::handler& cgh) {
+                cgh.parallel_for(sycl::range<1>(count),
+                    sycl::reduction(wave_sums, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+                    sycl::reduction(wave_sums + 1, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+                    [=](sycl::item<1> item, auto& sum, auto& err) {
+                    F f;
+                    Cell<D> cell = cells_in[item.get_id(0)];
+                    float volume = 1.0f;
+                    float x[D];
+                    for (int d = 0; d < D; d++) {
+                        volume *= cell.h;
+                        x[d] = cell.lo[d] + 0.5f * cell.h;
+                    }
+                    float midpoint = f(x) * volume;
+                    float gauss = 0.0f;
+                    for (unsigned m = 0; m < children; m++) {
+                        for (int d = 0; d < D; d++) {
+                            x[d] = cell.lo[d] + cell.h * (((m >> d) & 1) ? 0.5f + gauss_offset : 0.5f - gauss_offset);
+                        }
+                        gauss += f(x);
+                    }
+                    gauss *= volume / children;
+                    float local_error = sycl::fabs(gauss - midpoint);
+
+                    if (local_error > tolerance * volume && cell.h > min_size) {
+                        sycl::atomic_ref<unsigned, sycl::memory_order::relaxed, sycl::memory_scope::device, sycl::access::address_space::global_space> counter(*out_count);
+                        unsigned slot = counter.fetch_add(children);
+                        if (slot + children <= capacity) {
+                            for (unsigned m = 0; m < children; m++) {
+                                Cell<D> child;
+                                for (int d = 0; d < D; d++) {
+                                    child.lo[d] = cell.lo[d] + (((m >> d) & 1) ? 0.5f * cell.h : 0.0f);
+                                }
+                                child.h = 0.5f * cell.h;
+                                cells_out[slot + m] = child;
+                            }
+                            return;
+                        }
+                    }
+                    sum += gauss;
+                    err += local_error;
                 });
             });
-            queue.wait_and_throw();
-            start_time = event.get_profiling_info<sycl::info::event_profiling::command_start>();
-            end_time = event.get_profiling_info<sycl::info::event_profiling::command_end>();
-        } catch (sycl::exception &e) {
-            std::cout << e.what() << std::endl;
+            event.wait_and_throw();
+            kernel_ns += event.get_profiling_info<sycl::info::event_profiling::command_end>() - event.get_profiling_info<sycl::info::event_profiling::command_start>();
+            result += wave_sums[0];
+            error += wave_sums[1];
+            evaluations += (uint64_t)count * (children + 1);
+            waves++;
+            count = std::min(*out_count, capacity);
+            std::swap(cells_in, cells_out);
         }
+    } catch (sycl::exception &e) {
+        std::cout << e.what() << std::endl;
     }
 
-    float result = std::accumulate(group_results.begin(), group_results.end(), 0.0f);
+    sycl::free(cells_in, queue);
+    sycl::free(cells_out, queue);
+    sycl::free(out_count, queue);
+    sycl::free(wave_sums, queue);
 
-    std::cout << "Number of rectangles:\t" << N << " x " << N << std::endl;
+    std::cout << "Integrand:\t\t" << F::name() << std::endl;
+    std::cout << "Initial grid:\t\t" << N << "^" << D << std::endl;
     std::cout << "Target device:\t\t" << queue.get_device().get_info<sycl::info::device::name>() << std::endl;
-    std::cout << "Kernel time:\t\t" << (end_time - start_time) / 1000000 << " ms" << std::endl;
-    std::cout << "Expected:\t\t" << analytical_solution() << std::endl;
+    std::cout << "Tolerance:\t\t" << tolerance << std::endl;
+    std::cout << "Waves:\t\t\t" << waves << std::endl;
+    std::cout << "Evaluations:\t\t" << evaluations << std::endl;
+    std::cout << "Kernel time:\t\t" << kernel_ns / 1000000 << " ms" << std::endl;
+    std::cout << "Evaluations/s:\t\t" << (kernel_ns > 0 ? evaluations / (kernel_ns * 1e-9) : 0.0) << std::endl;
+    std::cout << "Expected:\t\t" << F::exact() << std::endl;
     std::cout << "Computed:\t\t" << result << std::endl;
-    std::cout << "Difference:\t\t" << fabs(result - analytical_solution()) << std::endl;
+    std::cout << "Estimated error:\t" << error << std::endl;
+    std::cout << "Difference:\t\t" << fabs(result - F::exact()) << std::endl;
 }
 
 int main(int argc, char* argv[]) {
-    auto args = parse_args(argc, argv);
-    integral(args.first, args.second);
+    Args args = parse_args(argc, argv);
+    LaunchConfig config = {(int)get_option(args, "wg", 0), (int)get_option(args, "groups", 4)};
+    std::string cache_path = get_option(args, "tune", 0) != 0 ? (args.options.count("tune_cache") ? args.options.at("tune_cache") : "integral_tune.cache") : "";
+    bool adaptive = args.options.count("tol") != 0;
+    float tolerance = get_option(args, "tol", 0);
+    unsigned capacity = get_option(args, "cells", 1 << 20);
+    if (args.options.count("batch")) {
+        batch_integral(args.N, args.device, get_option(args, "batch", 1024));
+        return 0;
+    }
+    if (args.integrand == "sincos") {
+        adaptive ? adaptive_integral<SinCos>(args.N, args.device, tolerance, capacity) : integral<SinCos>(args.N, args.device, config, cache_path);
+    } else if (args.integrand == "gauss3d") {
+        adaptive ? adaptive_integral<Gauss3D>(args.N, args.device, tolerance, capacity) : integral<Gauss3D>(args.N, args.device, config, cache_path);
+    } else {
+        std::cout << "Integrand error" << std::endl;
+        exit(-1);
+    }
     return 0;
-}
\ No newline at end of file
+}
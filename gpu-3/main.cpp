@@ -5,6 +5,32 @@
 #include <chrono>
 #include <numeric>
 #include <random>
+#include <algorithm>
+#include <map>
+#include <deque>
+#include <sstream>
+#include <fstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstring>
+#include <limits>
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#if !defined(__SYCL_DEVICE_ONLY__) && (defined(__x86_64__) || defined(_M_X64))
+#define NATIVE_SIMD_DISPATCH
+#include <immintrin.h>
+#include <cpuid.h>
+#endif
 
 void print_info() {
     std::vector<sycl::platform> platforms = sycl::platform::get_platforms();
@@ -18,6 +44,260 @@ void print_info() {
     std::cout << std::endl;
 }
 
+sycl::queue create_queue(std::string device_type, bool in_order = false) {
+    sycl::property_list properties = in_order
+        ? sycl::property_list{sycl::property::queue::enable_profiling(), sycl::property::queue::in_order()}
+        : sycl::property_list{sycl::property::queue::enable_profiling()};
+    if (device_type == "cpu") {
+        return sycl::queue(sycl::cpu_selector{}, properties);
+    } else if (device_type == "gpu") {
+        return sycl::queue(sycl::gpu_selector{}, properties);
+    }
+    std::cout << "Selector error" << std::endl;
+    exit(-1);
+}
+
+enum class Phase { Setup, Upload, Kernel, Copy, Check, Count };
+
+// Per-phase breakdown of a solve: device times come from command_start/command_end of profiled
+// events and are resolved only when printed, host times (setup/JIT, host checks) from steady_clock
+class PhaseProfiler {
+public:
+    void record(Phase phase, sycl::event event, std::string name = "", double bytes = 0.0) {
+        events.push_back({phase, name, bytes, event});
+    }
+
+    void record_host(Phase phase, std::chrono::steady_clock::time_point start) {
+        host_ns[(int)phase] += std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    // Host time of the phase without the device time of event, e.g. implicit buffer transfers around a kernel
+    void record_host(Phase phase, std::chrono::steady_clock::time_point start, sycl::event event) {
+        record_host(phase, start);
+        host_ns[(int)phase] -= device_ns(event);
+    }
+
+    void print(std::string version) const {
+        const char* phase_names[] = {"setup/JIT", "H2D", "kernels", "D2D/D2H", "host checks"};
+        struct Totals {
+            double ns = 0.0;
+            double bytes = 0.0;
+            int count = 0;
+        };
+        std::vector<double> phase_ns(host_ns, host_ns + (int)Phase::Count);
+        std::map<std::string, Totals> named;
+        for (const Record& r : events) {
+            double ns = device_ns(r.event);
+            phase_ns[(int)r.phase] += ns;
+            if (!r.name.empty()) {
+                Totals& totals = named[r.name];
+                totals.ns += ns;
+                totals.bytes += r.bytes;
+                totals.count++;
+            }
+        }
+        std::cout << "[" << version << "] Phases:";
+        for (int p = 0; p < (int)Phase::Count; p++) {
+            std::cout << " " << phase_names[p] << " " << std::max(phase_ns[p], 0.0) / 1e6 << " ms" << (p + 1 < (int)Phase::Count ? "," : "");
+        }
+        std::cout << std::endl;
+        for (const auto& entry : named) {
+            const Totals& totals = entry.second;
+            std::cout << "[" << version << "]   " << entry.first << ": " << totals.count << " x " << totals.ns / totals.count / 1e6 << " ms";
+            if (totals.bytes > 0.0 && totals.ns > 0.0) {
+                std::cout << ", " << totals.bytes / totals.ns << " GB/s";
+            }
+            std::cout << std::endl;
+        }
+    }
+
+private:
+    struct Record {
+        Phase phase;
+        std::string name;
+        double bytes;
+        sycl::event event;
+    };
+
+    static double device_ns(const sycl::event& event) {
+        uint64_t start = event.get_profiling_info<sycl::info::event_profiling::command_start>();
+        uint64_t end = event.get_profiling_info<sycl::info::event_profiling::command_end>();
+        return (double)(end - start);
+    }
+
+    std::vector<Record> events;
+    double host_ns[(int)Phase::Count] = {};
+};
+
+// Non-owning view of contiguous data, so a vector, a mapped file or a pinned buffer can be passed
+// to a solver without copying
+template <typename T>
+struct Span {
+    Span() {}
+    Span(T* ptr, size_t count) : ptr(ptr), count(count) {}
+    Span(const std::vector<typename std::remove_const<T>::type>& v) : ptr(v.data()), count(v.size()) {}
+
+    T* data() const { return ptr; }
+    size_t size() const { return count; }
+    T& operator[](size_t i) const { return ptr[i]; }
+    T* begin() const { return ptr; }
+    T* end() const { return ptr + count; }
+
+    T* ptr = nullptr;
+    size_t count = 0;
+};
+
+enum class Layout { RowMajor, ColMajor };
+
+template <Layout L>
+inline size_t matrix_index(int i, int j, int n) {
+    if constexpr (L == Layout::RowMajor) {
+        return (size_t)i * n + j;
+    } else {
+        return (size_t)j * n + i;
+    }
+}
+
+// CPU work-items stream contiguous rows, GPU work-items read coalesced columns
+Layout preferred_layout(const sycl::device& device) {
+    return device.is_cpu() ? Layout::RowMajor : Layout::ColMajor;
+}
+
+std::string layout_name(Layout layout) {
+    return layout == Layout::RowMajor ? "row-major" : "column-major";
+}
+
+// Systems are generated column-major, row-major is obtained by an in-place blocked transpose
+void convert_layout(std::vector<float>& A, int n, Layout layout) {
+    if (layout == Layout::ColMajor) {
+        return;
+    }
+    const int block = 64;
+    for (int ib = 0; ib < n; ib += block) {
+        for (int jb = ib; jb < n; jb += block) {
+            for (int i = ib; i < std::min(ib + block, n); i++) {
+                for (int j = std::max(jb, i + 1); j < std::min(jb + block, n); j++) {
+                    std::swap(A[(size_t)i * n + j], A[(size_t)j * n + i]);
+                }
+            }
+        }
+    }
+}
+
+template <Layout L, typename MatrixT, typename VectorT>
+inline float jacobi_row(const MatrixT& A, const VectorT& b, const VectorT& x, int i, int n) {
+    float sum = 0.0f;
+    for (int j = 0; j < i; j++) {
+        sum += A[matrix_index<L>(i, j, n)] * x[j];
+    }
+    for (int j = i + 1; j < n; j++) {
+        sum += A[matrix_index<L>(i, j, n)] * x[j];
+    }
+    return (b[i] - sum) / A[matrix_index<L>(i, i, n)];
+}
+
+// group_size = 0 leaves the work-group size to the runtime
+template <Layout L>
+sycl::event jacobi_sweep(sycl::queue& queue, const float* A, const float* b, const float* xk, float* xk1, int n, int group_size = 0) {
+    if (group_size <= 0) {
+        return queue.parallel_for(sycl::range<1>(n), [=](sycl::item<1> item) {
+            int i = item.get_id(0);
+            xk1[i] = jacobi_row<L>(A, b, xk, i, n);
+        });
+    }
+    size_t global_size = (size_t)(n + group_size - 1) / group_size * group_size;
+    return queue.parallel_for(sycl::nd_range<1>(sycl::range<1>(global_size), sycl::range<1>(group_size)), [=](sycl::nd_item<1> item) {
+        int i = item.get_global_id(0);
+        if (i < n) {
+            xk1[i] = jacobi_row<L>(A, b, xk, i, n);
+        }
+    });
+}
+
+template <Layout L>
+sycl::event jacobi_sweep(sycl::queue& queue, sycl::buffer<float>& A_buff, sycl::buffer<float>& b_buff, sycl::buffer<float>& xk_buff, sycl::buffer<float>& xk1_buff, int n) {
+    return queue.submit([&](sycl::handler &cgh) {
+        auto A_acc = A_buff.get_access<sycl::access::mode::read>(cgh);
+        auto b_acc = b_buff.get_access<sycl::access::mode::read>(cgh);
+        auto xk_acc = xk_buff.get_access<sycl::access::mode::read>(cgh);
+        auto xk1_acc = xk1_buff.get_access<sycl::access::mode::write>(cgh);
+
+        cgh.parallel_for(sycl::range<1>(n), [=](sycl::item<1> item) {
+            int i = item.get_id(0);
+            xk1_acc[i] = jacobi_row<L>(A_acc, b_acc, xk_acc, i, n);
+        });
+    });
+}
+
+sycl::event jacobi_sweep(sycl::queue& queue, Layout layout, const float* A, const float* b, const float* xk, float* xk1, int n, int group_size = 0) {
+    if (layout == Layout::RowMajor) {
+        return jacobi_sweep<Layout::RowMajor>(queue, A, b, xk, xk1, n, group_size);
+    }
+    return jacobi_sweep<Layout::ColMajor>(queue, A, b, xk, xk1, n, group_size);
+}
+
+sycl::event jacobi_sweep(sycl::queue& queue, Layout layout, sycl::buffer<float>& A_buff, sycl::buffer<float>& b_buff, sycl::buffer<float>& xk_buff, sycl::buffer<float>& xk1_buff, int n) {
+    if (layout == Layout::RowMajor) {
+        return jacobi_sweep<Layout::RowMajor>(queue, A_buff, b_buff, xk_buff, xk1_buff, n);
+    }
+    return jacobi_sweep<Layout::ColMajor>(queue, A_buff, b_buff, xk_buff, xk1_buff, n);
+}
+
+// One sub-group per row: lanes split the dot product, a work-group covers rows_per_group rows
+// and shares each tile of xk through local memory
+template <Layout L>
+sycl::event jacobi_sweep_group(sycl::queue& queue, const float* A, const float* b, const float* xk, float* xk1, int n, int group_size, int rows_per_group, int tile_size) {
+    size_t group_count = (n + rows_per_group - 1) / rows_per_group;
+    return queue.submit([&](sycl::handler &cgh) {
+        sycl::local_accessor<float, 1> tile(sycl::range<1>(tile_size), cgh);
+        sycl::local_accessor<float, 1> partial(sycl::range<1>(rows_per_group), cgh);
+
+        cgh.parallel_for(sycl::nd_range<1>(sycl::range<1>(group_count * group_size), sycl::range<1>(group_size)), [=](sycl::nd_item<1> item) {
+            sycl::sub_group sg = item.get_sub_group();
+            int local_id = item.get_local_id(0);
+            int sg_id = sg.get_group_id()[0];
+            int sg_count = sg.get_group_range()[0];
+            int lane = sg.get_local_id()[0];
+            int sg_size = sg.get_local_range()[0];
+            int first_row = item.get_group(0) * rows_per_group;
+
+            for (int r = local_id; r < rows_per_group; r += group_size) {
+                partial[r] = 0.0f;
+            }
+            for (int t = 0; t < n; t += tile_size) {
+                int tile_len = sycl::min(tile_size, n - t);
+                sycl::group_barrier(item.get_group());
+                for (int jj = local_id; jj < tile_len; jj += group_size) {
+                    tile[jj] = xk[t + jj];
+                }
+                sycl::group_barrier(item.get_group());
+                for (int r = sg_id; r < rows_per_group; r += sg_count) {
+                    int row = first_row + r;
+                    float sum = 0.0f;
+                    if (row < n) {
+                        for (int jj = lane; jj < tile_len; jj += sg_size) {
+                            if (t + jj != row) {
+                                sum += A[matrix_index<L>(row, t + jj, n)] * tile[jj];
+                            }
+                        }
+                    }
+                    sum = sycl::reduce_over_group(sg, sum, sycl::plus<float>());
+                    if (lane == 0) {
+                        partial[r] += sum;
+                    }
+                }
+            }
+            sycl::group_barrier(item.get_group());
+            for (int r = local_id; r < rows_per_group; r += group_size) {
+                int row = first_row + r;
+                if (row < n) {
+                    xk1[row] = (b[row] - partial[r]) / A[matrix_index<L>(row, row, n)];
+                }
+            }
+        });
+    });
+}
+
 float base_accuracy(std::vector<float> xk, std::vector<float> xk1) {
     float sum = 0.0f;
     for (int i = 0; i < xk.size(); i++) {
@@ -38,20 +318,80 @@ float relative_accuracy(std::vector<float> xk, std::vector<float> xk1) {
     return std::sqrt(top) / std::sqrt(bot);
 }
 
-float achived_accuracy(std::vector<float> A, std::vector<float> b, std::vector<float> x) {
+float achived_accuracy(const std::vector<float>& A, const std::vector<float>& b, const std::vector<float>& x, Layout layout) {
     float result = 0.0f;
     for (int i = 0; i < b.size(); i++) {
         float tmp = 0.0f - b[i];
         for (int j = 0; j < b.size(); j++) {
-            tmp += A[j * b.size() + i] * x[j];
+            size_t index = layout == Layout::RowMajor ? matrix_index<Layout::RowMajor>(i, j, b.size()) : matrix_index<Layout::ColMajor>(i, j, b.size());
+            tmp += A[index] * x[j];
         }
         result += tmp * tmp;
     }
     return std::sqrt(result);
 }
 
-std::vector<float> random_vector(int size, float min, float max) {
-    std::mt19937 gen(time(0));
+// norms[0] = ||xk - xk1||^2, norms[1] = ||xk||^2
+sycl::event relative_accuracy_norms(sycl::queue& queue, const float* xk, const float* xk1, int n, float* norms) {
+    return queue.parallel_for(sycl::range<1>(n),
+        sycl::reduction(norms, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        sycl::reduction(norms + 1, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& top, auto& bot) {
+            int i = item.get_id(0);
+            float tmp = xk[i] - xk1[i];
+            top += tmp * tmp;
+            bot += xk[i] * xk[i];
+        });
+}
+
+float relative_accuracy_device(sycl::queue& queue, const float* xk, const float* xk1, int n, float* norms, PhaseProfiler* profiler = nullptr) {
+    sycl::event reduction_event = relative_accuracy_norms(queue, xk, xk1, n, norms);
+    reduction_event.wait();
+    float host_norms[2];
+    sycl::event copy_event = queue.memcpy(host_norms, norms, 2 * sizeof(float));
+    copy_event.wait();
+    auto check_time = std::chrono::steady_clock::now();
+    float accuracy = std::sqrt(host_norms[0]) / std::sqrt(host_norms[1]);
+    if (profiler) {
+        profiler->record(Phase::Kernel, reduction_event, "relative_accuracy", 2.0 * n * sizeof(float));
+        profiler->record(Phase::Copy, copy_event);
+        profiler->record_host(Phase::Check, check_time);
+    }
+    return accuracy;
+}
+
+template <Layout L>
+float achived_accuracy_device(sycl::queue& queue, const float* A, const float* b, const float* x, int n, float* norms, PhaseProfiler* profiler = nullptr) {
+    sycl::event event = queue.parallel_for(sycl::range<1>(n),
+        sycl::reduction(norms, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& result) {
+            int i = item.get_id(0);
+            float tmp = 0.0f - b[i];
+            for (int j = 0; j < n; j++) {
+                tmp += A[matrix_index<L>(i, j, n)] * x[j];
+            }
+            result += tmp * tmp;
+        });
+    event.wait();
+    float host_result;
+    sycl::event copy_event = queue.memcpy(&host_result, norms, sizeof(float));
+    copy_event.wait();
+    if (profiler) {
+        profiler->record(Phase::Kernel, event, "achived_accuracy", ((double)n * n + 2.0 * n) * sizeof(float));
+        profiler->record(Phase::Copy, copy_event);
+    }
+    return std::sqrt(host_result);
+}
+
+float achived_accuracy_device(sycl::queue& queue, Layout layout, const float* A, const float* b, const float* x, int n, float* norms, PhaseProfiler* profiler = nullptr) {
+    if (layout == Layout::RowMajor) {
+        return achived_accuracy_device<Layout::RowMajor>(queue, A, b, x, n, norms, profiler);
+    }
+    return achived_accuracy_device<Layout::ColMajor>(queue, A, b, x, n, norms, profiler);
+}
+
+std::vector<float> random_vector(int size, float min, float max, unsigned seed = time(0)) {
+    std::mt19937 gen(seed);
     std::vector<float> result(size);
     std::uniform_real_distribution<float> distr(min, max);
     for (int i = 0; i < size; i++) {
@@ -70,21 +410,505 @@ std::pair<std::vector<float>, std::vector<float>> get_random_system(int N) {
     return std::pair<std::vector<float>, std::vector<float>>{A, b};
 }
 
-void print_results(std::string version, long long time, float accuracy, float accuracy_while, int iters, int max_iters) {
-    std::cout << "[" << version << "] " << "Time: " << time << " ms Accuracy: " << accuracy << " (" << accuracy_while << ")" << " Iters: " << iters << " / " << max_iters << std::endl;
+// Philox4x32-10 counter-based generator (Salmon et al., SC'11): every value is a pure function of
+// (seed, stream, index), so host threads and device work-items produce the same numbers
+inline uint32_t philox4x32(uint64_t seed, uint32_t stream, uint64_t index) {
+    uint32_t counter[4] = {(uint32_t)index, (uint32_t)(index >> 32), stream, 0};
+    uint32_t key0 = (uint32_t)seed;
+    uint32_t key1 = (uint32_t)(seed >> 32);
+    for (int round = 0; round < 10; round++) {
+        uint64_t product0 = (uint64_t)0xD2511F53u * counter[0];
+        uint64_t product1 = (uint64_t)0xCD9E8D57u * counter[2];
+        uint32_t next0 = (uint32_t)(product1 >> 32) ^ counter[1] ^ key0;
+        uint32_t next2 = (uint32_t)(product0 >> 32) ^ counter[3] ^ key1;
+        counter[1] = (uint32_t)product1;
+        counter[3] = (uint32_t)product0;
+        counter[0] = next0;
+        counter[2] = next2;
+        key0 += 0x9E3779B9u;
+        key1 += 0xBB67AE85u;
+    }
+    return counter[0];
 }
 
-std::vector<float> jacobi_accessors(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b) {
-    sycl::queue queue;
-    if (device_type == "cpu") {
-        queue = sycl::queue(sycl::cpu_selector{}, {sycl::property::queue::enable_profiling()});
-    } else if (device_type == "gpu") {
-        queue = sycl::queue(sycl::gpu_selector{}, {sycl::property::queue::enable_profiling()});
+// width must be a power of two: then width * u is exact and the result is rounded once,
+// with or without FMA contraction, which keeps host and device output bit-identical
+inline float philox_uniform(uint64_t seed, uint32_t stream, uint64_t index, float min, float width) {
+    float u = (philox4x32(seed, stream, index) >> 8) * (1.0f / 16777216.0f);
+    return min + width * u;
+}
+
+// Same distribution as get_random_system: off-diagonal in [1, 3), diagonal in [5N, 5N + 2)
+inline float system_entry(uint64_t seed, int i, int j, int N) {
+    if (i == j) {
+        return philox_uniform(seed, 2, i, N * 5.0f, 2.0f);
+    }
+    return philox_uniform(seed, 0, matrix_index<Layout::ColMajor>(i, j, N), 1.0f, 2.0f);
+}
+
+inline float system_rhs(uint64_t seed, int i) {
+    return philox_uniform(seed, 1, i, 1.0f, 2.0f);
+}
+
+std::pair<std::vector<float>, std::vector<float>> get_random_system(int N, uint64_t seed) {
+    std::vector<float> A((size_t)N * N);
+    std::vector<float> b(N);
+    int thread_count = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_count; t++) {
+        threads.emplace_back([&, t]() {
+            for (int j = t; j < N; j += thread_count) {
+                for (int i = 0; i < N; i++) {
+                    A[matrix_index<Layout::ColMajor>(i, j, N)] = system_entry(seed, i, j, N);
+                }
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    for (int i = 0; i < N; i++) {
+        b[i] = system_rhs(seed, i);
+    }
+    return std::pair<std::vector<float>, std::vector<float>>{A, b};
+}
+
+template <Layout L>
+sycl::event generate_system_device(sycl::queue& queue, float* A, float* b, int N, uint64_t seed) {
+    sycl::event b_event = queue.parallel_for(sycl::range<1>(N), [=](sycl::item<1> item) {
+        int i = item.get_id(0);
+        b[i] = system_rhs(seed, i);
+    });
+    // dimension 1 is the fastest one, so consecutive work-items write consecutive addresses;
+    // depending on the b kernel makes the returned event cover both arrays
+    return queue.parallel_for(sycl::range<2>(N, N), b_event, [=](sycl::item<2> item) {
+        int outer = item.get_id(0);
+        int inner = item.get_id(1);
+        int i = L == Layout::RowMajor ? outer : inner;
+        int j = L == Layout::RowMajor ? inner : outer;
+        A[matrix_index<L>(i, j, N)] = system_entry(seed, i, j, N);
+    });
+}
+
+struct CsrMatrix {
+    int n = 0;
+    std::vector<int> row_ptr;
+    std::vector<int> col_idx;
+    std::vector<float> values;
+};
+
+struct CsrView {
+    CsrView() {}
+    CsrView(const CsrMatrix& A) : n(A.n), row_ptr(A.row_ptr), col_idx(A.col_idx), values(A.values) {}
+
+    int n = 0;
+    Span<const int> row_ptr;
+    Span<const int> col_idx;
+    Span<const float> values;
+};
+
+// ELLPACK, stored column-major: the k-th entry of row i is at [k * n + i], padding has col_idx -1
+struct EllMatrix {
+    int n = 0;
+    int width = 0;
+    std::vector<int> col_idx;
+    std::vector<float> values;
+};
+
+std::pair<CsrMatrix, std::vector<float>> get_random_sparse_system(int N, int nnz_per_row) {
+    nnz_per_row = std::max(1, std::min(nnz_per_row, N));
+    std::mt19937 gen(time(0));
+    std::uniform_int_distribution<int> col_distr(0, N - 1);
+    std::uniform_real_distribution<float> value_distr(1.0f, 3.0f);
+    std::uniform_real_distribution<float> diag_distr(nnz_per_row * 5.0f, nnz_per_row * 5.0f + 2.0f);
+
+    CsrMatrix A;
+    A.n = N;
+    A.row_ptr.resize(N + 1);
+    A.col_idx.reserve((size_t)N * nnz_per_row);
+    A.values.reserve((size_t)N * nnz_per_row);
+    std::vector<int> cols;
+    for (int i = 0; i < N; i++) {
+        cols.clear();
+        cols.push_back(i);
+        while (cols.size() < (size_t)nnz_per_row) {
+            int j = col_distr(gen);
+            if (std::find(cols.begin(), cols.end(), j) == cols.end()) {
+                cols.push_back(j);
+            }
+        }
+        std::sort(cols.begin(), cols.end());
+        A.row_ptr[i] = A.col_idx.size();
+        for (int j : cols) {
+            A.col_idx.push_back(j);
+            A.values.push_back(j == i ? diag_distr(gen) : value_distr(gen));
+        }
+    }
+    A.row_ptr[N] = A.col_idx.size();
+
+    std::vector<float> b = random_vector(N, 1.0f, 3.0f);
+    return std::pair<CsrMatrix, std::vector<float>>{A, b};
+}
+
+EllMatrix csr_to_ell(const CsrMatrix& A) {
+    EllMatrix ell;
+    ell.n = A.n;
+    for (int i = 0; i < A.n; i++) {
+        ell.width = std::max(ell.width, A.row_ptr[i + 1] - A.row_ptr[i]);
+    }
+    ell.col_idx.assign((size_t)ell.width * A.n, -1);
+    ell.values.assign((size_t)ell.width * A.n, 0.0f);
+    for (int i = 0; i < A.n; i++) {
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++) {
+            size_t pos = (size_t)(k - A.row_ptr[i]) * A.n + i;
+            ell.col_idx[pos] = A.col_idx[k];
+            ell.values[pos] = A.values[k];
+        }
+    }
+    return ell;
+}
+
+// Binary system file: the header is followed by A (n * n floats in the given layout) or by the CSR
+// arrays (row_ptr, col_idx, values), and then by b. Every array is 4-byte aligned, so a mapped file
+// is used in place
+enum class SystemFormat : uint32_t { Dense = 0, Csr = 1 };
+
+struct SystemFileHeader {
+    char magic[4] = {'J', 'S', 'Y', 'S'};
+    uint32_t version = 1;
+    SystemFormat format = SystemFormat::Dense;
+    uint32_t layout = 0;
+    uint64_t n = 0;
+    uint64_t nnz = 0;
+};
+
+void file_error(const std::string& path, const std::string& message) {
+    std::cout << "File error: " << path << ": " << message << std::endl;
+    exit(-1);
+}
+
+// Read-only mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+        if (file == INVALID_HANDLE_VALUE) {
+            file_error(path, "cannot open");
+        }
+        LARGE_INTEGER file_size;
+        GetFileSizeEx(file, &file_size);
+        length = file_size.QuadPart;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping == nullptr) {
+            file_error(path, "cannot map");
+        }
+        address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            file_error(path, "cannot open");
+        }
+        struct stat st;
+        fstat(fd, &st);
+        length = st.st_size;
+        address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (address == MAP_FAILED) {
+            address = nullptr;
+        } else {
+            madvise(address, length, MADV_SEQUENTIAL);
+        }
+#endif
+        if (address == nullptr) {
+            file_error(path, "cannot map");
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    ~MappedFile() {
+#ifdef _WIN32
+        UnmapViewOfFile(address);
+        CloseHandle(mapping);
+        CloseHandle(file);
+#else
+        munmap(address, length);
+#endif
+    }
+
+    const char* data() const { return static_cast<const char*>(address); }
+    size_t size() const { return length; }
+
+private:
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = nullptr;
+#endif
+    void* address = nullptr;
+    size_t length = 0;
+};
+
+// A system whose arrays point into a mapped file, valid while the object lives
+struct MappedSystem {
+    std::unique_ptr<MappedFile> file;
+    SystemFileHeader header;
+    Layout layout = Layout::ColMajor;
+    Span<const float> A;
+    CsrView csr;
+    Span<const float> b;
+};
+
+MappedSystem map_system_file(const std::string& path) {
+    MappedSystem system;
+    system.file.reset(new MappedFile(path));
+    const char* data = system.file->data();
+    if (system.file->size() < sizeof(SystemFileHeader)) {
+        file_error(path, "too small");
+    }
+    std::memcpy(&system.header, data, sizeof(SystemFileHeader));
+    const SystemFileHeader& header = system.header;
+    if (std::memcmp(header.magic, "JSYS", 4) != 0 || header.version != 1) {
+        file_error(path, "not a system file");
+    }
+    if (header.format != SystemFormat::Dense && header.format != SystemFormat::Csr) {
+        file_error(path, "unknown storage format");
+    }
+
+    // n and nnz index int arrays on the device, and bounding them by the file size first keeps the
+    // expected size below from overflowing
+    size_t file_floats = system.file->size() / sizeof(float);
+    if (header.n == 0 || header.n > (uint64_t)std::numeric_limits<int>::max() || header.nnz > (uint64_t)std::numeric_limits<int>::max() ||
+        header.n > file_floats || header.nnz > file_floats || (header.format == SystemFormat::Dense && header.n > file_floats / header.n)) {
+        file_error(path, "size does not match the header");
+    }
+    size_t n = header.n;
+    size_t expected = sizeof(SystemFileHeader) + n * sizeof(float);
+    if (header.format == SystemFormat::Dense) {
+        expected += n * n * sizeof(float);
     } else {
-        std::cout << "Selector error" << std::endl;
-        exit(-1);
+        expected += (n + 1) * sizeof(int) + header.nnz * (sizeof(int) + sizeof(float));
+    }
+    if (system.file->size() != expected) {
+        file_error(path, "size does not match the header");
+    }
+
+    const char* pos = data + sizeof(SystemFileHeader);
+    if (header.format == SystemFormat::Dense) {
+        system.layout = header.layout == 0 ? Layout::RowMajor : Layout::ColMajor;
+        system.A = Span<const float>(reinterpret_cast<const float*>(pos), n * n);
+        pos += n * n * sizeof(float);
+    } else {
+        system.csr.n = n;
+        system.csr.row_ptr = Span<const int>(reinterpret_cast<const int*>(pos), n + 1);
+        pos += (n + 1) * sizeof(int);
+        system.csr.col_idx = Span<const int>(reinterpret_cast<const int*>(pos), header.nnz);
+        pos += header.nnz * sizeof(int);
+        system.csr.values = Span<const float>(reinterpret_cast<const float*>(pos), header.nnz);
+        pos += header.nnz * sizeof(float);
+    }
+    system.b = Span<const float>(reinterpret_cast<const float*>(pos), n);
+
+    // The arrays go to the device as they are, so the same checks as for MatrixMarket input
+    if (header.format == SystemFormat::Dense) {
+        for (size_t i = 0; i < n; i++) {
+            if (system.A[i * n + i] == 0.0f) {
+                file_error(path, "row " + std::to_string(i + 1) + " has no diagonal entry, Jacobi needs a non-zero diagonal");
+            }
+        }
+    } else {
+        const CsrView& A = system.csr;
+        if (A.row_ptr[0] != 0 || (uint64_t)A.row_ptr[n] != header.nnz) {
+            file_error(path, "row pointers do not match the number of entries");
+        }
+        for (size_t i = 0; i < n; i++) {
+            if (A.row_ptr[i + 1] < A.row_ptr[i]) {
+                file_error(path, "row pointers are not sorted");
+            }
+        }
+        for (size_t i = 0; i < n; i++) {
+            bool has_diag = false;
+            for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++) {
+                if (A.col_idx[k] < 0 || (size_t)A.col_idx[k] >= n) {
+                    file_error(path, "entry " + std::to_string(k + 1) + " is outside the matrix");
+                }
+                has_diag = has_diag || ((size_t)A.col_idx[k] == i && A.values[k] != 0.0f);
+            }
+            if (!has_diag) {
+                file_error(path, "row " + std::to_string(i + 1) + " has no diagonal entry, Jacobi needs a non-zero diagonal");
+            }
+        }
+    }
+    return system;
+}
+
+template <typename T>
+void write_array(std::ofstream& out, Span<const T> data) {
+    out.write(reinterpret_cast<const char*>(data.data()), data.size() * sizeof(T));
+}
+
+void write_system_file(const std::string& path, Span<const float> A, Span<const float> b, Layout layout) {
+    std::ofstream out(path, std::ios::binary);
+    SystemFileHeader header;
+    header.format = SystemFormat::Dense;
+    header.layout = layout == Layout::RowMajor ? 0 : 1;
+    header.n = b.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, A);
+    write_array(out, b);
+    if (!out) {
+        file_error(path, "write failed");
+    }
+}
+
+void write_system_file(const std::string& path, const CsrView& A, Span<const float> b) {
+    std::ofstream out(path, std::ios::binary);
+    SystemFileHeader header;
+    header.format = SystemFormat::Csr;
+    header.n = A.n;
+    header.nnz = A.values.size();
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    write_array(out, A.row_ptr);
+    write_array(out, A.col_idx);
+    write_array(out, A.values);
+    write_array(out, b);
+    if (!out) {
+        file_error(path, "write failed");
+    }
+}
+
+// Reads a real/integer/pattern coordinate MatrixMarket file line by line into CSR, symmetric
+// storage is expanded. The format carries no right-hand side, so b = A * ones and the exact
+// solution is a vector of ones
+std::pair<CsrMatrix, std::vector<float>> read_matrix_market(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        file_error(path, "cannot open");
+    }
+    std::string line;
+    std::getline(in, line);
+    std::string banner, object, format, field, symmetry;
+    std::istringstream(line) >> banner >> object >> format >> field >> symmetry;
+    for (std::string* word : {&object, &format, &field, &symmetry}) {
+        std::transform(word->begin(), word->end(), word->begin(), ::tolower);
+    }
+    if (banner != "%%MatrixMarket" || object != "matrix" || format != "coordinate" || field == "complex") {
+        file_error(path, "only real coordinate MatrixMarket matrices are supported");
+    }
+    bool pattern = field == "pattern";
+    bool symmetric = symmetry == "symmetric" || symmetry == "skew-symmetric";
+    float mirror_sign = symmetry == "skew-symmetric" ? -1.0f : 1.0f;
+
+    while (std::getline(in, line) && (line.empty() || line[0] == '%')) {}
+    long long rows = 0, cols = 0, entries = 0;
+    std::istringstream(line) >> rows >> cols >> entries;
+    if (rows <= 0 || rows != cols) {
+        file_error(path, "matrix must be square");
+    }
+
+    std::vector<int> row_idx, col_idx;
+    std::vector<float> values;
+    size_t capacity = symmetric ? 2 * entries : entries;
+    row_idx.reserve(capacity);
+    col_idx.reserve(capacity);
+    values.reserve(capacity);
+    long long read = 0;
+    for (long long k = 0; k < entries && std::getline(in, line); k++, read++) {
+        char* pos = &line[0];
+        int i = std::strtol(pos, &pos, 10) - 1;
+        int j = std::strtol(pos, &pos, 10) - 1;
+        float value = pattern ? 1.0f : std::strtof(pos, &pos);
+        if (i < 0 || i >= rows || j < 0 || j >= cols) {
+            file_error(path, "entry " + std::to_string(k + 1) + " is outside the matrix");
+        }
+        row_idx.push_back(i);
+        col_idx.push_back(j);
+        values.push_back(value);
+        if (symmetric && i != j) {
+            row_idx.push_back(j);
+            col_idx.push_back(i);
+            values.push_back(mirror_sign * value);
+        }
+    }
+    if (read < entries) {
+        file_error(path, "unexpected end of file");
+    }
+
+    CsrMatrix A;
+    A.n = rows;
+    A.row_ptr.assign(rows + 1, 0);
+    for (int i : row_idx) {
+        A.row_ptr[i + 1]++;
+    }
+    std::partial_sum(A.row_ptr.begin(), A.row_ptr.end(), A.row_ptr.begin());
+    A.col_idx.resize(values.size());
+    A.values.resize(values.size());
+    std::vector<int> next(A.row_ptr.begin(), A.row_ptr.end() - 1);
+    for (size_t k = 0; k < values.size(); k++) {
+        int pos = next[row_idx[k]]++;
+        A.col_idx[pos] = col_idx[k];
+        A.values[pos] = values[k];
+    }
+
+    std::vector<float> b(rows, 0.0f);
+    for (int i = 0; i < rows; i++) {
+        bool has_diag = false;
+        for (int k = A.row_ptr[i]; k < A.row_ptr[i + 1]; k++) {
+            b[i] += A.values[k];
+            has_diag = has_diag || (A.col_idx[k] == i && A.values[k] != 0.0f);
+        }
+        if (!has_diag) {
+            file_error(path, "row " + std::to_string(i + 1) + " has no diagonal entry, Jacobi needs a non-zero diagonal");
+        }
+    }
+    return std::pair<CsrMatrix, std::vector<float>>{A, b};
+}
+
+// Pins a host range for the duration of an upload where the runtime supports it, so a mapped
+// file is copied to the device without an intermediate staging copy
+class HostRegistration {
+public:
+    HostRegistration(sycl::queue& queue, const void* ptr, size_t bytes) : queue(queue), ptr(ptr) {
+#ifdef SYCL_EXT_ONEAPI_COPY_OPTIMIZE
+        sycl::ext::oneapi::experimental::prepare_for_device_copy(ptr, bytes, queue);
+#endif
     }
 
+    ~HostRegistration() {
+#ifdef SYCL_EXT_ONEAPI_COPY_OPTIMIZE
+        sycl::ext::oneapi::experimental::release_from_device_copy(ptr, queue);
+#endif
+    }
+
+private:
+    sycl::queue& queue;
+    const void* ptr;
+};
+
+// Filled by the solvers through their optional stats argument, for callers that compare runs
+struct SolveStats {
+    long long time_us = 0;
+    float accuracy = 0.0f;
+    float accuracy_while = 0.0f;
+    int iters = 0;
+};
+
+void print_results(std::string version, const SolveStats& stats, int max_iters) {
+    std::cout << "[" << version << "] " << "Time: " << stats.time_us / 1000 << " ms Accuracy: " << stats.accuracy << " (" << stats.accuracy_while << ")"
+              << " Iters: " << stats.iters << " / " << max_iters << std::endl;
+}
+
+std::vector<float> jacobi_accessors(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, bool profile = false, SolveStats* stats = nullptr) {
+    PhaseProfiler profiler;
+    auto setup_time = std::chrono::steady_clock::now();
+    sycl::queue queue = create_queue(device_type);
+
+    Layout layout = preferred_layout(queue.get_device());
+    convert_layout(A, N, layout);
+    profiler.record_host(Phase::Setup, setup_time);
+    const double sweep_bytes = ((double)N * N + 3.0 * N) * sizeof(float);
+
     sycl::buffer<float> A_buff(A.data(), A.size());
     sycl::buffer<float> b_buff(b.data(), b.size());
 
@@ -99,53 +923,49 @@ std::vector<float> jacobi_accessors(int N, float target_accuracy, int max_iters,
     do {
         iter_counter++;
         xk = xk1;
+        auto sweep_time = std::chrono::steady_clock::now();
+        sycl::event event;
         {
             sycl::buffer<float> xk_buff(xk.data(), xk.size());
             sycl::buffer<float> xk1_buff(xk1.data(), xk1.size());
-            sycl::event event = queue.submit([&](sycl::handler &cgh) {
-                auto A_acc = A_buff.get_access<sycl::access::mode::read>(cgh);
-                auto b_acc = b_buff.get_access<sycl::access::mode::read>(cgh);
-                auto xk_acc = xk_buff.get_access<sycl::access::mode::read>(cgh);
-                auto xk1_acc = xk1_buff.get_access<sycl::access::mode::write>(cgh);
-
-                cgh.parallel_for(sycl::range<1>(b.size()), [=](sycl::item<1> item) {
-                    int i = item.get_id(0);
-                    int n = item.get_range(0);
-                    float sum = 0.0f;
-                    for (int j = 0; j < n; j++) {
-                        if (i != j) {
-                            sum += A_acc[i + j * n] * xk_acc[j];
-                        }
-                    }
-                    xk1_acc[i] = (b_acc[i] - sum) / A_acc[i + i * n];
-                });
-            });
+            event = jacobi_sweep(queue, layout, A_buff, b_buff, xk_buff, xk1_buff, b.size());
+            // the first submission JIT-compiles the kernel
+            if (iter_counter == 1) {
+                profiler.record_host(Phase::Setup, sweep_time);
+                sweep_time = std::chrono::steady_clock::now();
+            }
             queue.wait();
         }
+        // the first sweep also uploads A and b, every sweep copies xk in and xk1 out on buffer destruction
+        profiler.record(Phase::Kernel, event, "jacobi_sweep", sweep_bytes);
+        profiler.record_host(iter_counter == 1 ? Phase::Upload : Phase::Copy, sweep_time, event);
+        auto check_time = std::chrono::steady_clock::now();
         accuracy = relative_accuracy(xk, xk1);
+        profiler.record_host(Phase::Check, check_time);
     } while (iter_counter < max_iters && accuracy > target_accuracy);
 
     auto end_time = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
-    float final_accuracy = achived_accuracy(A, b, xk1);
+    float final_accuracy = achived_accuracy(A, b, xk1, layout);
 
-    std::cout << "Target device: " << queue.get_device().get_info<sycl::info::device::name>() << std::endl;
-    print_results("Accessors", elapsed_ms.count(), final_accuracy, accuracy, iter_counter, max_iters);
+    std::cout << "Target device: " << queue.get_device().get_info<sycl::info::device::name>() << " (" << layout_name(layout) << ")" << std::endl;
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("Accessors", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    if (profile) {
+        profiler.print("Accessors");
+    }
 
     return xk1;
 }
 
-std::vector<float> jacobi_shared_mem(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b) {
-    sycl::queue queue;
-    if (device_type == "cpu") {
-        queue = sycl::queue(sycl::cpu_selector{}, {sycl::property::queue::enable_profiling()});
-    } else if (device_type == "gpu") {
-        queue = sycl::queue(sycl::gpu_selector{}, {sycl::property::queue::enable_profiling()});
-    } else {
-        std::cout << "Selector error" << std::endl;
-        exit(-1);
-    }
+std::vector<float> jacobi_shared_mem(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, bool profile = false, SolveStats* stats = nullptr) {
+    PhaseProfiler profiler;
+    auto setup_time = std::chrono::steady_clock::now();
+    sycl::queue queue = create_queue(device_type);
 
     float* A_shared = sycl::malloc_shared<float>(A.size(), queue);
     float* b_shared = sycl::malloc_shared<float>(b.size(), queue);
@@ -153,13 +973,17 @@ std::vector<float> jacobi_shared_mem(int N, float target_accuracy, int max_iters
     float* xk_shared = sycl::malloc_shared<float>(xk.size(), queue);
     std::vector<float> xk1 = b;
     float* xk1_shared = sycl::malloc_shared<float>(xk1.size(), queue);
+    float* norms_shared = sycl::malloc_shared<float>(2, queue);
 
-    queue.memcpy(A_shared, A.data(), A.size()*sizeof(float)).wait();
-    queue.memcpy(b_shared, b.data(), b.size()*sizeof(float)).wait();
-    queue.memcpy(xk_shared, xk.data(), xk.size()*sizeof(float)).wait();
-    queue.memcpy(xk1_shared, xk1.data(), xk1.size()*sizeof(float)).wait();
-    
-
+    Layout layout = preferred_layout(queue.get_device());
+    convert_layout(A, N, layout);
+    profiler.record_host(Phase::Setup, setup_time);
+    profiler.record(Phase::Upload, queue.memcpy(A_shared, A.data(), A.size()*sizeof(float)), "A upload", A.size()*sizeof(float));
+    profiler.record(Phase::Upload, queue.memcpy(b_shared, b.data(), b.size()*sizeof(float)));
+    profiler.record(Phase::Upload, queue.memcpy(xk_shared, xk.data(), xk.size()*sizeof(float)));
+    profiler.record(Phase::Upload, queue.memcpy(xk1_shared, xk1.data(), xk1.size()*sizeof(float)));
+    queue.wait();
+    const double sweep_bytes = ((double)N * N + 3.0 * N) * sizeof(float);
 
     int iter_counter = 0;
     float accuracy = 0.0f;
@@ -168,63 +992,68 @@ std::vector<float> jacobi_shared_mem(int N, float target_accuracy, int max_iters
 
     do {
         iter_counter++;
-        queue.memcpy(xk_shared, xk1_shared, xk.size()*sizeof(float)).wait();
-        queue.parallel_for(sycl::range<1>(b.size()), [=](sycl::item<1> item) {
-            int i = item.get_id(0);
-            int n = item.get_range(0);
-            float sum = 0.0f;
-            for (int j = 0; j < n; j++) {
-                if (i != j) {
-                    sum += A_shared[i + j * n] * xk_shared[j];
-                }
-            }
-            xk1_shared[i] = (b_shared[i] - sum) / A_shared[i + i * n];
-        }).wait();
-        queue.memcpy(xk.data(), xk_shared, xk.size()*sizeof(float)).wait();
-        queue.memcpy(xk1.data(), xk1_shared, xk1.size()*sizeof(float)).wait();
-        accuracy = relative_accuracy(xk, xk1);
+        std::swap(xk_shared, xk1_shared);
+        auto submit_time = std::chrono::steady_clock::now();
+        sycl::event event = jacobi_sweep(queue, layout, A_shared, b_shared, xk_shared, xk1_shared, b.size());
+        if (iter_counter == 1) {
+            profiler.record_host(Phase::Setup, submit_time);
+        }
+        event.wait();
+        profiler.record(Phase::Kernel, event, "jacobi_sweep", sweep_bytes);
+        accuracy = relative_accuracy_device(queue, xk_shared, xk1_shared, b.size(), norms_shared, &profiler);
     } while (iter_counter < max_iters && accuracy > target_accuracy);
 
     auto end_time = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
-    float final_accuracy = achived_accuracy(A, b, xk1);
+    sycl::event download_event = queue.memcpy(xk1.data(), xk1_shared, xk1.size()*sizeof(float));
+    download_event.wait();
+    profiler.record(Phase::Copy, download_event);
+    float final_accuracy = achived_accuracy_device(queue, layout, A_shared, b_shared, xk1_shared, b.size(), norms_shared, &profiler);
 
     sycl::free(A_shared, queue);
     sycl::free(b_shared, queue);
     sycl::free(xk_shared, queue);
     sycl::free(xk1_shared, queue);
+    sycl::free(norms_shared, queue);
 
-    print_results("  Shared ", elapsed_ms.count(), final_accuracy, accuracy, iter_counter, max_iters);
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("  Shared ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    if (profile) {
+        profiler.print("  Shared ");
+    }
 
     return xk1;
 
 }
 
-std::vector<float> jacobi_device_mem(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b) {
-    sycl::queue queue;
-    if (device_type == "cpu") {
-        queue = sycl::queue(sycl::cpu_selector{}, {sycl::property::queue::enable_profiling()});
-    } else if (device_type == "gpu") {
-        queue = sycl::queue(sycl::gpu_selector{}, {sycl::property::queue::enable_profiling()});
-    } else {
-        std::cout << "Selector error" << std::endl;
-        exit(-1);
-    }
+// Solves with A in the given layout straight from the caller's memory (e.g. a mapped file), A is
+// never copied on the host
+std::vector<float> jacobi_device_mem(sycl::queue& queue, int N, float target_accuracy, int max_iters, Span<const float> A, Span<const float> b, Layout layout, bool profile = false, int group_size = 0, SolveStats* stats = nullptr) {
+    PhaseProfiler profiler;
+    auto setup_time = std::chrono::steady_clock::now();
 
     float* A_device = sycl::malloc_device<float>(A.size(), queue);
     float* b_device = sycl::malloc_device<float>(b.size(), queue);
     std::vector<float> xk(b.size());
     float* xk_device = sycl::malloc_device<float>(xk.size(), queue);
-    std::vector<float> xk1 = b;
+    std::vector<float> xk1(b.begin(), b.end());
     float* xk1_device = sycl::malloc_device<float>(xk1.size(), queue);
+    float* norms_device = sycl::malloc_device<float>(2, queue);
 
-    queue.memcpy(A_device, A.data(), A.size()*sizeof(float)).wait();
-    queue.memcpy(b_device, b.data(), b.size()*sizeof(float)).wait();
-    queue.memcpy(xk_device, xk.data(), xk.size()*sizeof(float)).wait();
-    queue.memcpy(xk1_device, xk1.data(), xk1.size()*sizeof(float)).wait();
-    
-
+    profiler.record_host(Phase::Setup, setup_time);
+    {
+        HostRegistration registration(queue, A.data(), A.size()*sizeof(float));
+        profiler.record(Phase::Upload, queue.memcpy(A_device, A.data(), A.size()*sizeof(float)), "A upload", A.size()*sizeof(float));
+        profiler.record(Phase::Upload, queue.memcpy(b_device, b.data(), b.size()*sizeof(float)));
+        profiler.record(Phase::Upload, queue.memcpy(xk_device, xk.data(), xk.size()*sizeof(float)));
+        profiler.record(Phase::Upload, queue.memcpy(xk1_device, xk1.data(), xk1.size()*sizeof(float)));
+        queue.wait();
+    }
+    const double sweep_bytes = ((double)N * N + 3.0 * N) * sizeof(float);
 
     int iter_counter = 0;
     float accuracy = 0.0f;
@@ -233,83 +1062,2222 @@ std::vector<float> jacobi_device_mem(int N, float target_accuracy, int max_iters
 
     do {
         iter_counter++;
-        queue.memcpy(xk_device, xk1_device, xk.size()*sizeof(float)).wait();
-        queue.parallel_for(sycl::range<1>(b.size()), [=](sycl::item<1> item) {
-            int i = item.get_id(0);
+        std::swap(xk_device, xk1_device);
+        auto submit_time = std::chrono::steady_clock::now();
+        sycl::event event = jacobi_sweep(queue, layout, A_device, b_device, xk_device, xk1_device, b.size(), group_size);
+        if (iter_counter == 1) {
+            profiler.record_host(Phase::Setup, submit_time);
+        }
+        event.wait();
+        profiler.record(Phase::Kernel, event, "jacobi_sweep", sweep_bytes);
+        accuracy = relative_accuracy_device(queue, xk_device, xk1_device, b.size(), norms_device, &profiler);
+    } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    sycl::event download_event = queue.memcpy(xk1.data(), xk1_device, xk1.size()*sizeof(float));
+    download_event.wait();
+    profiler.record(Phase::Copy, download_event);
+    float final_accuracy = achived_accuracy_device(queue, layout, A_device, b_device, xk1_device, b.size(), norms_device, &profiler);
+
+    sycl::free(A_device, queue);
+    sycl::free(b_device, queue);
+    sycl::free(xk_device, queue);
+    sycl::free(xk1_device, queue);
+    sycl::free(norms_device, queue);
+
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("  Device ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    if (profile) {
+        profiler.print("  Device ");
+    }
+
+    return xk1;
+}
+
+std::vector<float> jacobi_device_mem(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, bool profile = false, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+    Layout layout = preferred_layout(queue.get_device());
+    convert_layout(A, N, layout);
+    return jacobi_device_mem(queue, N, target_accuracy, max_iters, A, b, layout, profile, 0, stats);
+}
+
+// Rows handled by a work-group of jacobi_sweep_group: one per sub-group of the smallest size
+int group_rows(const sycl::device& device, int group_size) {
+    std::vector<size_t> sg_sizes = device.get_info<sycl::info::device::sub_group_sizes>();
+    int min_sg_size = sg_sizes.empty() ? 1 : *std::min_element(sg_sizes.begin(), sg_sizes.end());
+    return std::max(1, group_size / min_sg_size);
+}
+
+std::vector<float> jacobi_group(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, int group_size, int tile_size, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+
+    group_size = std::min<int>(group_size, queue.get_device().get_info<sycl::info::device::max_work_group_size>());
+    int rows_per_group = group_rows(queue.get_device(), group_size);
+
+    float* A_device = sycl::malloc_device<float>(A.size(), queue);
+    float* b_device = sycl::malloc_device<float>(b.size(), queue);
+    float* xk_device = sycl::malloc_device<float>(b.size(), queue);
+    std::vector<float> xk1 = b;
+    float* xk1_device = sycl::malloc_device<float>(xk1.size(), queue);
+    float* norms_device = sycl::malloc_device<float>(2, queue);
+
+    convert_layout(A, N, Layout::RowMajor);
+    queue.memcpy(A_device, A.data(), A.size()*sizeof(float)).wait();
+    queue.memcpy(b_device, b.data(), b.size()*sizeof(float)).wait();
+    queue.memset(xk_device, 0, b.size()*sizeof(float)).wait();
+    queue.memcpy(xk1_device, xk1.data(), xk1.size()*sizeof(float)).wait();
+
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    do {
+        iter_counter++;
+        std::swap(xk_device, xk1_device);
+        jacobi_sweep_group<Layout::RowMajor>(queue, A_device, b_device, xk_device, xk1_device, N, group_size, rows_per_group, tile_size).wait();
+        accuracy = relative_accuracy_device(queue, xk_device, xk1_device, N, norms_device);
+    } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    queue.memcpy(xk1.data(), xk1_device, xk1.size()*sizeof(float)).wait();
+    float final_accuracy = achived_accuracy_device(queue, Layout::RowMajor, A_device, b_device, xk1_device, N, norms_device);
+
+    sycl::free(A_device, queue);
+    sycl::free(b_device, queue);
+    sycl::free(xk_device, queue);
+    sycl::free(xk1_device, queue);
+    sycl::free(norms_device, queue);
+
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("  Group  ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+
+    return xk1;
+}
+
+// Upper bound of the spectral radius of the Jacobi iteration matrix D^-1 (D - A) from Gershgorin discs
+template <Layout L>
+sycl::event gershgorin_radius(sycl::queue& queue, const float* A, int n, float* radius) {
+    return queue.parallel_for(sycl::range<1>(n),
+        sycl::reduction(radius, sycl::maximum<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& result) {
+            int i = item.get_id(0);
+            float sum = 0.0f;
+            for (int j = 0; j < n; j++) {
+                sum += j != i ? sycl::fabs(A[matrix_index<L>(i, j, n)]) : 0.0f;
+            }
+            result.combine(sum / sycl::fabs(A[matrix_index<L>(i, i, n)]));
+        });
+}
+
+// x_{k+1} = x_{k-1} + omega * (gamma * J(x_k) + (1 - gamma) * x_k - x_{k-1}), where J is the plain
+// Jacobi update. omega = 1 with x_prev = x_k gives weighted Jacobi, the Chebyshev iteration changes
+// omega every step
+template <Layout L>
+sycl::event jacobi_sweep_extrapolated(sycl::queue& queue, const float* A, const float* b, const float* x_prev, const float* xk, float* xk1, int n, float gamma, float omega) {
+    return queue.parallel_for(sycl::range<1>(n), [=](sycl::item<1> item) {
+        int i = item.get_id(0);
+        float y = gamma * jacobi_row<L>(A, b, xk, i, n) + (1.0f - gamma) * xk[i];
+        xk1[i] = x_prev[i] + omega * (y - x_prev[i]);
+    });
+}
+
+// Updates the rows of one colour (parity of the row index). Colour 0 reads only xk, colour 1 already
+// sees the new colour 0 values in xk1. Rows of the same colour are coupled in a dense matrix, so
+// within a colour this is a Jacobi step
+template <Layout L>
+sycl::event gauss_seidel_colour(sycl::queue& queue, const float* A, const float* b, const float* xk, float* xk1, int n, int colour) {
+    return queue.parallel_for(sycl::range<1>((n + 1 - colour) / 2), [=](sycl::item<1> item) {
+        int i = 2 * item.get_id(0) + colour;
+        float sum = 0.0f;
+        for (int j = 0; j < n; j++) {
+            if (j != i) {
+                sum += A[matrix_index<L>(i, j, n)] * (j % 2 < colour ? xk1[j] : xk[j]);
+            }
+        }
+        xk1[i] = (b[i] - sum) / A[matrix_index<L>(i, i, n)];
+    });
+}
+
+// <x2 - x1, x1 - x0> and <x1 - x0, x1 - x0>. Successive plain Jacobi differences satisfy
+// d_k = G d_{k-1}, so the ratio estimates the dominant eigenvalue of G together with its sign
+sycl::event difference_products(sycl::queue& queue, const float* x0, const float* x1, const float* x2, int n, float* products) {
+    return queue.parallel_for(sycl::range<1>(n),
+        sycl::reduction(products, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        sycl::reduction(products + 1, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& cross, auto& square) {
+            int i = item.get_id(0);
+            float d1 = x1[i] - x0[i];
+            cross += (x2[i] - x1[i]) * d1;
+            square += d1 * d1;
+        });
+}
+
+// Weighted Jacobi, red-black Gauss-Seidel and Chebyshev-accelerated Jacobi with the same stopping
+// rule as jacobi_device_mem. The eigenvalues of the Jacobi iteration matrix are assumed to lie in
+// [lambda_min, lambda_max]; NaN bounds are replaced by the Gershgorin radius +-rho. omega = 0 picks
+// the optimal weight 2 / (2 - lambda_min - lambda_max). The Gershgorin bounds are symmetric and would
+// give omega = 1, so weighted Jacobi without bounds or omega instead runs two plain sweeps, estimates
+// the dominant eigenvalue lambda_1 from them and takes the spectrum to lie between 0 and lambda_1
+template <Layout L>
+std::vector<float> jacobi_accelerated(sycl::queue& queue, int N, float target_accuracy, int max_iters, std::vector<float> A, std::vector<float> b, std::string method, float lambda_min, float lambda_max, float omega, SolveStats* stats = nullptr) {
+    float* A_device = sycl::malloc_device<float>(A.size(), queue);
+    float* b_device = sycl::malloc_device<float>(N, queue);
+    float* x_device[3];
+    for (int k = 0; k < 3; k++) {
+        x_device[k] = sycl::malloc_device<float>(N, queue);
+    }
+    float* norms_device = sycl::malloc_device<float>(2, queue);
+
+    convert_layout(A, N, L);
+    queue.memcpy(A_device, A.data(), A.size()*sizeof(float));
+    queue.memcpy(b_device, b.data(), N*sizeof(float));
+    queue.memcpy(x_device[1], b.data(), N*sizeof(float));
+    queue.memcpy(x_device[2], b.data(), N*sizeof(float));
+    queue.wait();
+
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    const int estimate_sweeps = 2;
+    bool estimate_omega = method == "weighted" && omega == 0.0f && std::isnan(lambda_min) && std::isnan(lambda_max);
+    if (!estimate_omega && (std::isnan(lambda_min) || std::isnan(lambda_max))) {
+        float rho = 0.0f;
+        gershgorin_radius<L>(queue, A_device, N, norms_device).wait();
+        queue.memcpy(&rho, norms_device, sizeof(float)).wait();
+        lambda_min = std::isnan(lambda_min) ? -rho : lambda_min;
+        lambda_max = std::isnan(lambda_max) ? rho : lambda_max;
+    }
+    float gamma = 2.0f / (2.0f - lambda_min - lambda_max);
+    float sigma = (lambda_max - lambda_min) / (2.0f - lambda_min - lambda_max);
+    float chebyshev_omega = 1.0f;
+    if (omega == 0.0f && !estimate_omega) {
+        omega = gamma;
+    } else if (estimate_omega) {
+        // the estimation sweeps are plain Jacobi, a solve that stops during them stays omega = 1
+        omega = 1.0f;
+    }
+    bool spectrum_estimated = false;
+
+    // x_device[0] = x_{k-1}, x_device[1] = x_k, x_device[2] = x_{k+1}
+    do {
+        iter_counter++;
+        std::rotate(x_device, x_device + 1, x_device + 3);
+        if (method == "weighted" && estimate_omega && iter_counter <= estimate_sweeps) {
+            jacobi_sweep_extrapolated<L>(queue, A_device, b_device, x_device[1], x_device[1], x_device[2], N, 1.0f, 1.0f).wait();
+            if (iter_counter == estimate_sweeps) {
+                float products[2];
+                difference_products(queue, x_device[0], x_device[1], x_device[2], N, norms_device).wait();
+                queue.memcpy(products, norms_device, 2 * sizeof(float)).wait();
+                float lambda_1 = products[1] > 0.0f ? std::max(-0.99f, std::min(0.99f, products[0] / products[1])) : 0.0f;
+                lambda_min = std::min(lambda_1, 0.0f);
+                lambda_max = std::max(lambda_1, 0.0f);
+                omega = 2.0f / (2.0f - lambda_min - lambda_max);
+                spectrum_estimated = true;
+            }
+        } else if (method == "weighted") {
+            jacobi_sweep_extrapolated<L>(queue, A_device, b_device, x_device[1], x_device[1], x_device[2], N, omega, 1.0f).wait();
+        } else if (method == "redblack") {
+            // the two colours together write every entry of x_{k+1}
+            gauss_seidel_colour<L>(queue, A_device, b_device, x_device[1], x_device[2], N, 0).wait();
+            gauss_seidel_colour<L>(queue, A_device, b_device, x_device[1], x_device[2], N, 1).wait();
+        } else {
+            if (iter_counter == 2) {
+                chebyshev_omega = 1.0f / (1.0f - sigma * sigma / 2.0f);
+            } else if (iter_counter > 2) {
+                chebyshev_omega = 1.0f / (1.0f - sigma * sigma * chebyshev_omega / 4.0f);
+            }
+            jacobi_sweep_extrapolated<L>(queue, A_device, b_device, x_device[0], x_device[1], x_device[2], N, gamma, chebyshev_omega).wait();
+        }
+        accuracy = relative_accuracy_device(queue, x_device[1], x_device[2], N, norms_device);
+    } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    std::vector<float> x(N);
+    queue.memcpy(x.data(), x_device[2], N*sizeof(float)).wait();
+    float final_accuracy = achived_accuracy_device<L>(queue, A_device, b_device, x_device[2], N, norms_device);
+
+    sycl::free(A_device, queue);
+    sycl::free(b_device, queue);
+    for (int k = 0; k < 3; k++) {
+        sycl::free(x_device[k], queue);
+    }
+    sycl::free(norms_device, queue);
+
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    if (method == "weighted") {
+        std::cout << "[Weighted ] omega: " << omega << (spectrum_estimated ? " (estimated spectrum: [" + std::to_string(lambda_min) + ", " + std::to_string(lambda_max) + "])" : "") << std::endl;
+        if (std::fabs(omega - 1.0f) < 1e-3f) {
+            std::cout << "[Weighted ] omega is 1, this is plain Jacobi" << std::endl;
+        }
+        print_results("Weighted ", result, max_iters);
+    } else if (method == "redblack") {
+        print_results("Red-Black", result, max_iters);
+    } else {
+        std::cout << "[Chebyshev] Spectral bounds: [" << lambda_min << ", " << lambda_max << "]" << std::endl;
+        print_results("Chebyshev", result, max_iters);
+    }
+
+    return x;
+}
+
+std::vector<float> jacobi_accelerated(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, std::string method, float lambda_min, float lambda_max, float omega, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+    if (preferred_layout(queue.get_device()) == Layout::RowMajor) {
+        return jacobi_accelerated<Layout::RowMajor>(queue, N, target_accuracy, max_iters, A, b, method, lambda_min, lambda_max, omega, stats);
+    }
+    return jacobi_accelerated<Layout::ColMajor>(queue, N, target_accuracy, max_iters, A, b, method, lambda_min, lambda_max, omega, stats);
+}
+
+// Inner sweep of the mixed-precision solver: off-diagonal entries come from reduced-precision
+// storage (the diagonal is kept separately in float), the correction is accumulated in float
+template <Layout L, typename MatrixT>
+sycl::event jacobi_sweep_mixed(sycl::queue& queue, const MatrixT* A, const float* diag, const float* r, const float* dk, float* dk1, int n) {
+    return queue.parallel_for(sycl::range<1>(n), [=](sycl::item<1> item) {
+        int i = item.get_id(0);
+        float sum = 0.0f;
+        for (int j = 0; j < i; j++) {
+            sum += static_cast<float>(A[matrix_index<L>(i, j, n)]) * dk[j];
+        }
+        for (int j = i + 1; j < n; j++) {
+            sum += static_cast<float>(A[matrix_index<L>(i, j, n)]) * dk[j];
+        }
+        dk1[i] = (r[i] - sum) / diag[i];
+    });
+}
+
+// r = b - A x with the full-precision matrix, accumulated in double; norm receives ||r||^2
+template <Layout L>
+sycl::event residual_double(sycl::queue& queue, const float* A, const float* b, const double* x, float* r, double* norm, int n) {
+    return queue.parallel_for(sycl::range<1>(n),
+        sycl::reduction(norm, sycl::plus<double>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& result) {
+            int i = item.get_id(0);
+            double tmp = b[i];
+            for (int j = 0; j < n; j++) {
+                tmp -= (double)A[matrix_index<L>(i, j, n)] * x[j];
+            }
+            r[i] = (float)tmp;
+            result += tmp * tmp;
+        });
+}
+
+// Iterative refinement: Jacobi on the reduced-precision matrix solves A d = r,
+// the solution x and the residual r = b - A x are kept in double
+template <Layout L, typename MatrixT>
+std::vector<float> jacobi_mixed(sycl::queue& queue, int N, float target_accuracy, int max_iters, std::vector<float> A, std::vector<float> b, double refine_accuracy, int max_outer_iters, SolveStats* stats = nullptr) {
+    if (!queue.get_device().has(sycl::aspect::fp64)) {
+        std::cout << "Mixed precision: device has no fp64 support" << std::endl;
+        return {};
+    }
+
+    convert_layout(A, N, L);
+    std::vector<MatrixT> A_low(A.size());
+    std::vector<float> diag(N);
+    for (int i = 0; i < N; i++) {
+        for (int j = 0; j < N; j++) {
+            size_t index = matrix_index<L>(i, j, N);
+            A_low[index] = static_cast<MatrixT>(i == j ? 0.0f : A[index]);
+        }
+        diag[i] = A[matrix_index<L>(i, i, N)];
+    }
+
+    float* A_device = sycl::malloc_device<float>(A.size(), queue);
+    MatrixT* A_low_device = sycl::malloc_device<MatrixT>(A_low.size(), queue);
+    float* diag_device = sycl::malloc_device<float>(N, queue);
+    float* b_device = sycl::malloc_device<float>(N, queue);
+    double* x_device = sycl::malloc_device<double>(N, queue);
+    float* r_device = sycl::malloc_device<float>(N, queue);
+    float* dk_device = sycl::malloc_device<float>(N, queue);
+    float* dk1_device = sycl::malloc_device<float>(N, queue);
+    float* norms_device = sycl::malloc_device<float>(2, queue);
+    double* residual_device = sycl::malloc_device<double>(1, queue);
+
+    queue.memcpy(A_device, A.data(), A.size()*sizeof(float));
+    queue.memcpy(A_low_device, A_low.data(), A_low.size()*sizeof(MatrixT));
+    queue.memcpy(diag_device, diag.data(), N*sizeof(float));
+    queue.memcpy(b_device, b.data(), N*sizeof(float));
+    queue.memset(x_device, 0, N*sizeof(double)).wait();
+
+    double b_norm = 0.0;
+    for (int i = 0; i < N; i++) {
+        b_norm += (double)b[i] * b[i];
+    }
+    b_norm = std::sqrt(b_norm);
+
+    int iter_counter = 0;
+    int outer_counter = 0;
+    float accuracy = 0.0f;
+    double relative_residual = 0.0;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    while (true) {
+        double residual_norm = 0.0;
+        residual_double<L>(queue, A_device, b_device, x_device, r_device, residual_device, N);
+        queue.memcpy(&residual_norm, residual_device, sizeof(double)).wait();
+        relative_residual = std::sqrt(residual_norm) / b_norm;
+        if (relative_residual <= refine_accuracy || outer_counter >= max_outer_iters || iter_counter >= max_iters) {
+            break;
+        }
+        outer_counter++;
+
+        queue.memcpy(dk1_device, r_device, N*sizeof(float));
+        int inner_counter = 0;
+        do {
+            iter_counter++;
+            inner_counter++;
+            std::swap(dk_device, dk1_device);
+            jacobi_sweep_mixed<L>(queue, A_low_device, diag_device, r_device, dk_device, dk1_device, N);
+            accuracy = relative_accuracy_device(queue, dk_device, dk1_device, N, norms_device);
+        } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+        const float* d = dk1_device;
+        double* x = x_device;
+        queue.parallel_for(sycl::range<1>(N), [=](sycl::item<1> item) {
+            int i = item.get_id(0);
+            x[i] += d[i];
+        });
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    std::vector<double> x_double(N);
+    queue.memcpy(x_double.data(), x_device, N*sizeof(double)).wait();
+    std::vector<float> x(x_double.begin(), x_double.end());
+
+    sycl::free(A_device, queue);
+    sycl::free(A_low_device, queue);
+    sycl::free(diag_device, queue);
+    sycl::free(b_device, queue);
+    sycl::free(x_device, queue);
+    sycl::free(r_device, queue);
+    sycl::free(dk_device, queue);
+    sycl::free(dk1_device, queue);
+    sycl::free(norms_device, queue);
+    sycl::free(residual_device, queue);
+
+    double sweep_mb = (double)N * N * sizeof(MatrixT) / (1024 * 1024);
+    double sweep_mb_float = (double)N * N * sizeof(float) / (1024 * 1024);
+    SolveStats result = {elapsed_us.count(), (float)(relative_residual * b_norm), accuracy, iter_counter};
+    print_results("  Mixed  ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    std::cout << "[  Mixed  ] Storage: " << sizeof(MatrixT) * 8 << "-bit A, " << sweep_mb << " MB per sweep (fp32: " << sweep_mb_float << " MB, saving "
+              << 100.0 * (1.0 - sweep_mb / sweep_mb_float) << "%) Refinement steps: " << outer_counter << " Relative residual: " << relative_residual << std::endl;
+
+    return x;
+}
+
+std::vector<float> jacobi_mixed(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, double refine_accuracy, int max_outer_iters, bool half_storage, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type, true);
+    Layout layout = preferred_layout(queue.get_device());
+    if (half_storage && layout == Layout::RowMajor) {
+        return jacobi_mixed<Layout::RowMajor, sycl::half>(queue, N, target_accuracy, max_iters, A, b, refine_accuracy, max_outer_iters, stats);
+    } else if (half_storage) {
+        return jacobi_mixed<Layout::ColMajor, sycl::half>(queue, N, target_accuracy, max_iters, A, b, refine_accuracy, max_outer_iters, stats);
+    } else if (layout == Layout::RowMajor) {
+        return jacobi_mixed<Layout::RowMajor, float>(queue, N, target_accuracy, max_iters, A, b, refine_accuracy, max_outer_iters, stats);
+    }
+    return jacobi_mixed<Layout::ColMajor, float>(queue, N, target_accuracy, max_iters, A, b, refine_accuracy, max_outer_iters, stats);
+}
+
+const int batch_tile = 16;
+
+// Each loaded A(i, j) is reused for up to batch_tile active right-hand sides held in registers.
+// X, B are n x k column blocks, active holds the indices of the columns still iterating
+template <Layout L>
+sycl::event jacobi_sweep_batch(sycl::queue& queue, const float* A, const float* B, const float* Xk, float* Xk1, const int* active, int active_count, int n) {
+    return queue.parallel_for(sycl::range<1>(n), [=](sycl::item<1> item) {
+        int i = item.get_id(0);
+        float diag = A[matrix_index<L>(i, i, n)];
+        for (int c0 = 0; c0 < active_count; c0 += batch_tile) {
+            int cols = sycl::min(batch_tile, active_count - c0);
+            size_t offset[batch_tile];
+            float sum[batch_tile];
+            for (int c = 0; c < batch_tile; c++) {
+                offset[c] = c < cols ? (size_t)active[c0 + c] * n : 0;
+                sum[c] = 0.0f;
+            }
+            for (int j = 0; j < i; j++) {
+                float a = A[matrix_index<L>(i, j, n)];
+                for (int c = 0; c < batch_tile; c++) {
+                    sum[c] += a * Xk[offset[c] + j];
+                }
+            }
+            for (int j = i + 1; j < n; j++) {
+                float a = A[matrix_index<L>(i, j, n)];
+                for (int c = 0; c < batch_tile; c++) {
+                    sum[c] += a * Xk[offset[c] + j];
+                }
+            }
+            for (int c = 0; c < cols; c++) {
+                Xk1[offset[c] + i] = (B[offset[c] + i] - sum[c]) / diag;
+            }
+        }
+    });
+}
+
+// norms[2 * a] = ||Xk1 - Xk||^2, norms[2 * a + 1] = ||Xk||^2 of the a-th active column, one work-group per column
+sycl::event relative_accuracy_batch(sycl::queue& queue, const float* Xk, const float* Xk1, const int* active, int active_count, int n, float* norms) {
+    const int group_size = 256;
+    return queue.parallel_for(sycl::nd_range<1>(sycl::range<1>(active_count * group_size), sycl::range<1>(group_size)), [=](sycl::nd_item<1> item) {
+        int a = item.get_group(0);
+        size_t offset = (size_t)active[a] * n;
+        float top = 0.0f;
+        float bot = 0.0f;
+        for (int i = item.get_local_id(0); i < n; i += group_size) {
+            float tmp = Xk[offset + i] - Xk1[offset + i];
+            top += tmp * tmp;
+            bot += Xk[offset + i] * Xk[offset + i];
+        }
+        top = sycl::reduce_over_group(item.get_group(), top, sycl::plus<float>());
+        bot = sycl::reduce_over_group(item.get_group(), bot, sycl::plus<float>());
+        if (item.get_local_id(0) == 0) {
+            norms[2 * a] = top;
+            norms[2 * a + 1] = bot;
+        }
+    });
+}
+
+// CPU devices are split into NUMA sub-devices when the runtime supports it
+std::vector<sycl::device> get_multi_devices(std::string device_type) {
+    std::vector<sycl::device> devices;
+    if (device_type == "cpu" || device_type == "all") {
+        for (sycl::device cpu : sycl::device::get_devices(sycl::info::device_type::cpu)) {
+            try {
+                auto sub_devices = cpu.create_sub_devices<sycl::info::partition_property::partition_by_affinity_domain>(sycl::info::partition_affinity_domain::numa);
+                if (sub_devices.size() > 1) {
+                    devices.insert(devices.end(), sub_devices.begin(), sub_devices.end());
+                    continue;
+                }
+            } catch (sycl::exception &e) {
+            }
+            devices.push_back(cpu);
+        }
+    }
+    if (device_type == "gpu" || device_type == "all") {
+        for (sycl::device gpu : sycl::device::get_devices(sycl::info::device_type::gpu)) {
+            devices.push_back(gpu);
+        }
+    }
+    if (devices.empty()) {
+        std::cout << "Selector error" << std::endl;
+        exit(-1);
+    }
+    return devices;
+}
+
+// Sweep over rows [first_row, first_row + rows) of a row-major slice of A, xk is the full vector
+sycl::event jacobi_sweep_rows(sycl::queue& queue, const float* A, const float* b, const float* xk, float* xk1, int first_row, int rows, int n) {
+    return queue.parallel_for(sycl::range<1>(rows), [=](sycl::item<1> item) {
+        int r = item.get_id(0);
+        int i = first_row + r;
+        const float* row = A + (size_t)r * n;
+        float sum = 0.0f;
+        for (int j = 0; j < i; j++) {
+            sum += row[j] * xk[j];
+        }
+        for (int j = i + 1; j < n; j++) {
+            sum += row[j] * xk[j];
+        }
+        xk1[r] = (b[r] - sum) / row[i];
+    });
+}
+
+std::vector<float> jacobi_multi_device(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, SolveStats* stats = nullptr) {
+    std::vector<sycl::device> devices = get_multi_devices(device_type);
+    int device_count = devices.size();
+    std::vector<sycl::queue> queues;
+    for (sycl::device& device : devices) {
+        queues.push_back(sycl::queue(device, {sycl::property::queue::enable_profiling(), sycl::property::queue::in_order()}));
+    }
+    convert_layout(A, N, Layout::RowMajor);
+
+    // Throughput calibration: every device sweeps the same block of rows once for JIT and once timed
+    int calibration_rows = std::min(N, 512);
+    std::vector<double> rows_per_second(device_count);
+    for (int d = 0; d < device_count; d++) {
+        sycl::queue& queue = queues[d];
+        float* A_calib = sycl::malloc_device<float>((size_t)calibration_rows * N, queue);
+        float* b_calib = sycl::malloc_device<float>(calibration_rows, queue);
+        float* xk_calib = sycl::malloc_device<float>(N, queue);
+        float* xk1_calib = sycl::malloc_device<float>(calibration_rows, queue);
+        queue.memcpy(A_calib, A.data(), (size_t)calibration_rows * N * sizeof(float));
+        queue.memcpy(b_calib, b.data(), calibration_rows * sizeof(float));
+        queue.memcpy(xk_calib, b.data(), N * sizeof(float));
+        jacobi_sweep_rows(queue, A_calib, b_calib, xk_calib, xk1_calib, 0, calibration_rows, N).wait();
+        sycl::event event = jacobi_sweep_rows(queue, A_calib, b_calib, xk_calib, xk1_calib, 0, calibration_rows, N);
+        event.wait();
+        uint64_t start = event.get_profiling_info<sycl::info::event_profiling::command_start>();
+        uint64_t end = event.get_profiling_info<sycl::info::event_profiling::command_end>();
+        rows_per_second[d] = calibration_rows / std::max((end - start) * 1e-9, 1e-9);
+        sycl::free(A_calib, queue);
+        sycl::free(b_calib, queue);
+        sycl::free(xk_calib, queue);
+        sycl::free(xk1_calib, queue);
+    }
+
+    double total_rate = std::accumulate(rows_per_second.begin(), rows_per_second.end(), 0.0);
+    std::vector<int> first_row(device_count + 1);
+    double cumulative_rate = 0.0;
+    for (int d = 0; d < device_count; d++) {
+        cumulative_rate += rows_per_second[d];
+        first_row[d + 1] = d + 1 == device_count ? N : (int)std::round(N * cumulative_rate / total_rate);
+    }
+
+    std::vector<float*> A_device(device_count), b_device(device_count), xk_device(device_count), xk1_device(device_count), norms_device(device_count);
+    for (int d = 0; d < device_count; d++) {
+        sycl::queue& queue = queues[d];
+        int rows = first_row[d + 1] - first_row[d];
+        A_device[d] = sycl::malloc_device<float>(std::max<size_t>((size_t)rows * N, 1), queue);
+        b_device[d] = sycl::malloc_device<float>(std::max(rows, 1), queue);
+        xk_device[d] = sycl::malloc_device<float>(N, queue);
+        xk1_device[d] = sycl::malloc_device<float>(std::max(rows, 1), queue);
+        norms_device[d] = sycl::malloc_device<float>(2, queue);
+        queue.memcpy(A_device[d], A.data() + (size_t)first_row[d] * N, (size_t)rows * N * sizeof(float));
+        queue.memcpy(b_device[d], b.data() + first_row[d], rows * sizeof(float));
+        queue.memcpy(xk_device[d], b.data(), N * sizeof(float));
+    }
+    for (sycl::queue& queue : queues) {
+        queue.wait();
+    }
+
+    std::vector<float> x_host[2] = {b, b};
+    std::vector<float> norms_host(2 * device_count);
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    do {
+        std::vector<float>& x = x_host[iter_counter % 2];
+        iter_counter++;
+        std::vector<sycl::event> events;
+        for (int d = 0; d < device_count; d++) {
+            int rows = first_row[d + 1] - first_row[d];
+            if (rows == 0) {
+                norms_host[2 * d] = norms_host[2 * d + 1] = 0.0f;
+                continue;
+            }
+            sycl::queue& queue = queues[d];
+            jacobi_sweep_rows(queue, A_device[d], b_device[d], xk_device[d], xk1_device[d], first_row[d], rows, N);
+            relative_accuracy_norms(queue, xk_device[d] + first_row[d], xk1_device[d], rows, norms_device[d]);
+            queue.memcpy(x.data() + first_row[d], xk1_device[d], rows * sizeof(float));
+            events.push_back(queue.memcpy(norms_host.data() + 2 * d, norms_device[d], 2 * sizeof(float)));
+        }
+        sycl::event::wait(events);
+
+        float top = 0.0f;
+        float bot = 0.0f;
+        for (int d = 0; d < device_count; d++) {
+            top += norms_host[2 * d];
+            bot += norms_host[2 * d + 1];
+        }
+        accuracy = std::sqrt(top) / std::sqrt(bot);
+
+        for (int d = 0; d < device_count; d++) {
+            queues[d].memcpy(xk_device[d], x.data(), N * sizeof(float));
+        }
+    } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+    for (sycl::queue& queue : queues) {
+        queue.wait();
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    float final_accuracy = 0.0f;
+    for (int d = 0; d < device_count; d++) {
+        int rows = first_row[d + 1] - first_row[d];
+        if (rows == 0) {
+            continue;
+        }
+        const float* A_slice = A_device[d];
+        const float* b_slice = b_device[d];
+        const float* x = xk_device[d];
+        int n = N;
+        queues[d].parallel_for(sycl::range<1>(rows),
+            sycl::reduction(norms_device[d], sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+            [=](sycl::item<1> item, auto& result) {
+                int r = item.get_id(0);
+                float tmp = 0.0f - b_slice[r];
+                for (int j = 0; j < n; j++) {
+                    tmp += A_slice[(size_t)r * n + j] * x[j];
+                }
+                result += tmp * tmp;
+            });
+        float partial = 0.0f;
+        queues[d].memcpy(&partial, norms_device[d], sizeof(float)).wait();
+        final_accuracy += partial;
+    }
+    final_accuracy = std::sqrt(final_accuracy);
+
+    for (int d = 0; d < device_count; d++) {
+        std::cout << "Target device " << d << ": " << devices[d].get_info<sycl::info::device::name>() << " rows: " << first_row[d + 1] - first_row[d]
+                  << " (calibrated " << rows_per_second[d] / 1e6 << " Mrows/s)" << std::endl;
+        sycl::free(A_device[d], queues[d]);
+        sycl::free(b_device[d], queues[d]);
+        sycl::free(xk_device[d], queues[d]);
+        sycl::free(xk1_device[d], queues[d]);
+        sycl::free(norms_device[d], queues[d]);
+    }
+
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("  Multi  ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+
+    return x_host[(iter_counter - 1) % 2];
+}
+
+template <Layout L>
+class SessionSweep;
+
+// Keeps the queue, the device copy of A, the vectors and the compiled kernels alive
+// between solves, so only b is uploaded per right-hand side
+class JacobiSession {
+public:
+    JacobiSession(std::string device_type, std::vector<float> A, int N)
+        : start_time(std::chrono::steady_clock::now()),
+          N(N),
+          queue(create_queue(device_type, true)),
+          layout(preferred_layout(queue.get_device())),
+          bundle(build_bundle(queue, layout)) {
+        allocate();
+        convert_layout(A, N, layout);
+        queue.memcpy(A_device, A.data(), A.size()*sizeof(float));
+        finish_startup();
+    }
+
+    // Generates the system of get_random_system(N, seed) directly in device memory
+    JacobiSession(std::string device_type, int N, uint64_t seed)
+        : start_time(std::chrono::steady_clock::now()),
+          N(N),
+          queue(create_queue(device_type, true)),
+          layout(preferred_layout(queue.get_device())),
+          bundle(build_bundle(queue, layout)) {
+        allocate();
+        if (layout == Layout::RowMajor) {
+            generate_system_device<Layout::RowMajor>(queue, A_device, b_device, N, seed);
+        } else {
+            generate_system_device<Layout::ColMajor>(queue, A_device, b_device, N, seed);
+        }
+        finish_startup();
+    }
+
+    JacobiSession(const JacobiSession&) = delete;
+    JacobiSession& operator=(const JacobiSession&) = delete;
+
+    ~JacobiSession() {
+        sycl::free(A_device, queue);
+        sycl::free(b_device, queue);
+        sycl::free(xk_device, queue);
+        sycl::free(xk1_device, queue);
+        sycl::free(norms_device, queue);
+        sycl::free(norms_host, queue);
+        sycl::free(B_device, queue);
+        sycl::free(X_device, queue);
+        sycl::free(X1_device, queue);
+        sycl::free(active_device, queue);
+        sycl::free(batch_norms_device, queue);
+    }
+
+    std::vector<float> solve(const std::vector<float>& b, float target_accuracy, int max_iters) {
+        auto start_time = std::chrono::steady_clock::now();
+
+        queue.memcpy(b_device, b.data(), N*sizeof(float));
+        queue.memcpy(xk1_device, b_device, N*sizeof(float));
+
+        int iter_counter = 0;
+        float accuracy = 0.0f;
+        do {
+            iter_counter++;
+            std::swap(xk_device, xk1_device);
+            sweep(xk_device, xk1_device);
+            accuracy = relative_accuracy_device(queue, xk_device, xk1_device, N, norms_device);
+        } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+        std::vector<float> x(N);
+        queue.memcpy(x.data(), xk1_device, N*sizeof(float)).wait();
+
+        auto end_time = std::chrono::steady_clock::now();
+        last_solve_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+        last_iters = iter_counter;
+        last_accuracy_while = accuracy;
+        return x;
+    }
+
+    // Enqueues check_interval sweeps back-to-back and only then a convergence check, without
+    // host synchronization in between. check_interval <= 0 derives the interval from the observed
+    // convergence rate. With overlap the next batch is already queued while the host waits for
+    // the check of the previous one, so up to one extra batch may run after convergence
+    std::vector<float> solve_pipelined(const std::vector<float>& b, float target_accuracy, int max_iters, int check_interval, bool overlap) {
+        auto start_time = std::chrono::steady_clock::now();
+
+        queue.memcpy(b_device, b.data(), N*sizeof(float));
+        queue.memcpy(xk1_device, b_device, N*sizeof(float));
+
+        struct PendingCheck {
+            int slot;
+            int iters;
+            sycl::event event;
+        };
+        std::deque<PendingCheck> pending;
+        bool auto_interval = check_interval <= 0;
+        int interval = auto_interval ? 4 : check_interval;
+        int iter_counter = 0;
+        int slot = 0;
+
+        auto enqueue_batch = [&]() {
+            int sweeps = std::min(interval, max_iters - iter_counter);
+            for (int k = 0; k < sweeps; k++) {
+                std::swap(xk_device, xk1_device);
+                sweep(xk_device, xk1_device);
+            }
+            iter_counter += sweeps;
+            relative_accuracy_norms(queue, xk_device, xk1_device, N, norms_device + 2 * slot);
+            sycl::event event = queue.memcpy(norms_host + 2 * slot, norms_device + 2 * slot, 2*sizeof(float));
+            pending.push_back({slot, iter_counter, event});
+            slot ^= 1;
+        };
+
+        float accuracy = 0.0f;
+        float prev_accuracy = 0.0f;
+        int prev_iters = 0;
+        enqueue_batch();
+        while (!pending.empty()) {
+            if (overlap && pending.size() < 2 && iter_counter < max_iters) {
+                enqueue_batch();
+            }
+            PendingCheck check = pending.front();
+            pending.pop_front();
+            check.event.wait();
+            accuracy = std::sqrt(norms_host[2 * check.slot]) / std::sqrt(norms_host[2 * check.slot + 1]);
+
+            if (accuracy <= target_accuracy || check.iters >= max_iters) {
+                for (PendingCheck& rest : pending) {
+                    rest.event.wait();
+                    accuracy = std::sqrt(norms_host[2 * rest.slot]) / std::sqrt(norms_host[2 * rest.slot + 1]);
+                }
+                break;
+            }
+            if (auto_interval && prev_accuracy > 0.0f && accuracy < prev_accuracy) {
+                double rate = std::pow((double)accuracy / prev_accuracy, 1.0 / (check.iters - prev_iters));
+                double remaining = std::ceil(std::log((double)target_accuracy / accuracy) / std::log(rate));
+                interval = (int)std::max(1.0, std::min(64.0, remaining));
+            }
+            prev_accuracy = accuracy;
+            prev_iters = check.iters;
+            if (pending.empty() && iter_counter < max_iters) {
+                enqueue_batch();
+            }
+        }
+
+        std::vector<float> x(N);
+        queue.memcpy(x.data(), xk1_device, N*sizeof(float)).wait();
+
+        auto end_time = std::chrono::steady_clock::now();
+        last_solve_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+        last_iters = iter_counter;
+        last_accuracy_while = accuracy;
+        return x;
+    }
+
+    // Solves A X = B for k right-hand sides stored column by column, every column stops
+    // iterating as soon as it reaches target_accuracy
+    std::vector<float> solve_batch(const std::vector<float>& B, int k, float target_accuracy, int max_iters) {
+        auto start_time = std::chrono::steady_clock::now();
+
+        reserve_batch(k);
+        queue.memcpy(B_device, B.data(), B.size()*sizeof(float));
+        queue.memcpy(X1_device, B_device, B.size()*sizeof(float));
+
+        std::vector<int> active(k);
+        std::iota(active.begin(), active.end(), 0);
+        queue.memcpy(active_device, active.data(), k*sizeof(int));
+
+        std::vector<float> X(B.size());
+        std::vector<float> norms(2 * k);
+        batch_iters.assign(k, 0);
+        float worst_accuracy = 0.0f;
+        int iter_counter = 0;
+        while (!active.empty() && iter_counter < max_iters) {
+            iter_counter++;
+            std::swap(X_device, X1_device);
+            int active_count = active.size();
+            if (layout == Layout::RowMajor) {
+                jacobi_sweep_batch<Layout::RowMajor>(queue, A_device, B_device, X_device, X1_device, active_device, active_count, N);
+            } else {
+                jacobi_sweep_batch<Layout::ColMajor>(queue, A_device, B_device, X_device, X1_device, active_device, active_count, N);
+            }
+            relative_accuracy_batch(queue, X_device, X1_device, active_device, active_count, N, batch_norms_device);
+            queue.memcpy(norms.data(), batch_norms_device, 2*active_count*sizeof(float)).wait();
+
+            std::vector<int> still_active;
+            for (int a = 0; a < active_count; a++) {
+                int c = active[a];
+                batch_iters[c] = iter_counter;
+                float accuracy = std::sqrt(norms[2 * a]) / std::sqrt(norms[2 * a + 1]);
+                if (accuracy > target_accuracy && iter_counter < max_iters) {
+                    still_active.push_back(c);
+                } else {
+                    queue.memcpy(X.data() + (size_t)c * N, X1_device + (size_t)c * N, N*sizeof(float));
+                    worst_accuracy = std::max(worst_accuracy, accuracy);
+                }
+            }
+            if (still_active.size() != active.size()) {
+                active = still_active;
+                queue.memcpy(active_device, active.data(), active.size()*sizeof(int));
+            }
+        }
+        queue.wait();
+
+        auto end_time = std::chrono::steady_clock::now();
+        last_solve_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+        last_iters = iter_counter;
+        last_accuracy_while = worst_accuracy;
+        return X;
+    }
+
+    float residual(const std::vector<float>& b, const std::vector<float>& x) {
+        queue.memcpy(b_device, b.data(), N*sizeof(float));
+        queue.memcpy(xk_device, x.data(), N*sizeof(float)).wait();
+        return achived_accuracy_device(queue, layout, A_device, b_device, xk_device, N, norms_device);
+    }
+
+    sycl::queue& get_queue() { return queue; }
+    Layout get_layout() const { return layout; }
+    long long get_startup_us() const { return startup_us; }
+    long long get_last_solve_us() const { return last_solve_us; }
+    int get_last_iters() const { return last_iters; }
+    float get_last_accuracy_while() const { return last_accuracy_while; }
+    const std::vector<int>& get_batch_iters() const { return batch_iters; }
+
+    // A in the session's layout, b of the last solve (or the generated one)
+    std::pair<std::vector<float>, std::vector<float>> download_system() {
+        std::vector<float> A((size_t)N * N);
+        std::vector<float> b(N);
+        queue.memcpy(A.data(), A_device, A.size()*sizeof(float));
+        queue.memcpy(b.data(), b_device, N*sizeof(float)).wait();
+        return {A, b};
+    }
+
+private:
+    void allocate() {
+        A_device = sycl::malloc_device<float>((size_t)N * N, queue);
+        b_device = sycl::malloc_device<float>(N, queue);
+        xk_device = sycl::malloc_device<float>(N, queue);
+        xk1_device = sycl::malloc_device<float>(N, queue);
+        norms_device = sycl::malloc_device<float>(4, queue);
+        norms_host = sycl::malloc_host<float>(4, queue);
+        queue.memset(b_device, 0, N*sizeof(float));
+    }
+
+    // Only the sweep kernel for the session's layout is built, not every kernel in the program
+    // (fp64 and half ones included)
+    static sycl::kernel_bundle<sycl::bundle_state::executable> build_bundle(const sycl::queue& queue, Layout layout) {
+        sycl::kernel_id sweep_id = layout == Layout::RowMajor ? sycl::get_kernel_id<SessionSweep<Layout::RowMajor>>() : sycl::get_kernel_id<SessionSweep<Layout::ColMajor>>();
+        return sycl::get_kernel_bundle<sycl::bundle_state::executable>(queue.get_context(), {queue.get_device()}, {sweep_id});
+    }
+
+    void finish_startup() {
+        queue.memset(xk_device, 0, N*sizeof(float)).wait();
+
+        // warm-up launches so the reduction kernels shared with the stand-alone solvers are
+        // JIT-compiled before the first solve
+        sweep(xk_device, xk1_device).wait();
+        relative_accuracy_device(queue, xk_device, xk1_device, N, norms_device);
+        relative_accuracy_norms(queue, xk_device, xk1_device, N, norms_device).wait();
+
+        auto end_time = std::chrono::steady_clock::now();
+        startup_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time).count();
+    }
+
+    void reserve_batch(int k) {
+        if (k <= batch_capacity) {
+            return;
+        }
+        sycl::free(B_device, queue);
+        sycl::free(X_device, queue);
+        sycl::free(X1_device, queue);
+        sycl::free(active_device, queue);
+        sycl::free(batch_norms_device, queue);
+        B_device = sycl::malloc_device<float>((size_t)N * k, queue);
+        X_device = sycl::malloc_device<float>((size_t)N * k, queue);
+        X1_device = sycl::malloc_device<float>((size_t)N * k, queue);
+        active_device = sycl::malloc_device<int>(k, queue);
+        batch_norms_device = sycl::malloc_device<float>(2 * k, queue);
+        batch_capacity = k;
+    }
+
+    sycl::event sweep(const float* xk, float* xk1) {
+        if (layout == Layout::RowMajor) {
+            return sweep<Layout::RowMajor>(xk, xk1);
+        }
+        return sweep<Layout::ColMajor>(xk, xk1);
+    }
+
+    template <Layout L>
+    sycl::event sweep(const float* xk, float* xk1) {
+        const float* A = A_device;
+        const float* b = b_device;
+        int n = N;
+        return queue.submit([&](sycl::handler &cgh) {
+            cgh.use_kernel_bundle(bundle);
+            cgh.parallel_for<SessionSweep<L>>(sycl::range<1>(n), [=](sycl::item<1> item) {
+                int i = item.get_id(0);
+                xk1[i] = jacobi_row<L>(A, b, xk, i, n);
+            });
+        });
+    }
+
+    std::chrono::steady_clock::time_point start_time;
+    int N;
+    sycl::queue queue;
+    Layout layout;
+    sycl::kernel_bundle<sycl::bundle_state::executable> bundle;
+    float* A_device;
+    float* b_device;
+    float* xk_device;
+    float* xk1_device;
+    float* norms_device;
+    float* norms_host;
+    float* B_device = nullptr;
+    float* X_device = nullptr;
+    float* X1_device = nullptr;
+    int* active_device = nullptr;
+    float* batch_norms_device = nullptr;
+    int batch_capacity = 0;
+    std::vector<int> batch_iters;
+    long long startup_us = 0;
+    long long last_solve_us = 0;
+    int last_iters = 0;
+    float last_accuracy_while = 0.0f;
+};
+
+void jacobi_session_benchmark(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, int solves) {
+    JacobiSession session(device_type, A, N);
+    std::cout << "Target device: " << session.get_queue().get_device().get_info<sycl::info::device::name>() << " (" << layout_name(session.get_layout()) << ")" << std::endl;
+    std::cout << "[ Session ] Startup: " << session.get_startup_us() / 1000.0 << " ms (queue, upload of A, JIT)" << std::endl;
+
+    long long total_us = 0;
+    long long min_us = 0;
+    for (int k = 0; k < solves; k++) {
+        std::vector<float> b = random_vector(N, 1.0f, 3.0f, k);
+        std::vector<float> x = session.solve(b, target_accuracy, max_iters);
+        long long solve_us = session.get_last_solve_us();
+        total_us += solve_us;
+        min_us = k == 0 ? solve_us : std::min(min_us, solve_us);
+        print_results(" Session ", {solve_us, session.residual(b, x), session.get_last_accuracy_while(), session.get_last_iters()}, max_iters);
+    }
+    std::cout << "[ Session ] Solves: " << solves << " Per-solve latency: avg " << total_us / 1000.0 / std::max(solves, 1) << " ms, min " << min_us / 1000.0 << " ms" << std::endl;
+}
+
+void jacobi_batch_benchmark(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, int k) {
+    JacobiSession session(device_type, A, N);
+    std::cout << "Target device: " << session.get_queue().get_device().get_info<sycl::info::device::name>() << " (" << layout_name(session.get_layout()) << ")" << std::endl;
+
+    std::vector<float> B((size_t)N * k);
+    for (int c = 0; c < k; c++) {
+        std::vector<float> b = random_vector(N, 1.0f, 3.0f, c);
+        std::copy(b.begin(), b.end(), B.begin() + (size_t)c * N);
+    }
+
+    std::vector<float> X = session.solve_batch(B, k, target_accuracy, max_iters);
+    long long batch_us = session.get_last_solve_us();
+    int batch_iter_counter = session.get_last_iters();
+    float batch_accuracy_while = session.get_last_accuracy_while();
+    std::vector<int> batch_iters = session.get_batch_iters();
+
+    long long single_us = 0;
+    float max_difference = 0.0f;
+    float max_residual = 0.0f;
+    int iters_mismatch = 0;
+    for (int c = 0; c < k; c++) {
+        std::vector<float> b(B.begin() + (size_t)c * N, B.begin() + (size_t)(c + 1) * N);
+        std::vector<float> x = session.solve(b, target_accuracy, max_iters);
+        single_us += session.get_last_solve_us();
+        iters_mismatch += session.get_last_iters() != batch_iters[c];
+        for (int i = 0; i < N; i++) {
+            max_difference = std::max(max_difference, std::fabs(x[i] - X[(size_t)c * N + i]));
+        }
+        std::vector<float> x_batch(X.begin() + (size_t)c * N, X.begin() + (size_t)(c + 1) * N);
+        max_residual = std::max(max_residual, session.residual(b, x_batch));
+    }
+
+    print_results("  Batch  ", {batch_us, max_residual, batch_accuracy_while, batch_iter_counter}, max_iters);
+    std::cout << "[  Batch  ] RHS: " << k << " Batched: " << batch_us / 1000.0 << " ms Independent: " << single_us / 1000.0 << " ms"
+              << " Max difference: " << max_difference << " Iteration mismatches: " << iters_mismatch << std::endl;
+}
+
+void jacobi_pipelined_benchmark(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, int check_interval, bool overlap) {
+    JacobiSession session(device_type, A, N);
+    std::cout << "Target device: " << session.get_queue().get_device().get_info<sycl::info::device::name>() << " (" << layout_name(session.get_layout()) << ")" << std::endl;
+
+    std::vector<float> x = session.solve(b, target_accuracy, max_iters);
+    print_results(" Session ", {session.get_last_solve_us(), session.residual(b, x), session.get_last_accuracy_while(), session.get_last_iters()}, max_iters);
+
+    x = session.solve_pipelined(b, target_accuracy, max_iters, check_interval, overlap);
+    print_results("Pipelined", {session.get_last_solve_us(), session.residual(b, x), session.get_last_accuracy_while(), session.get_last_iters()}, max_iters);
+    std::cout << "[Pipelined] Check interval: " << (check_interval <= 0 ? std::string("auto") : std::to_string(check_interval))
+              << " Overlap: " << (overlap ? "on" : "off") << std::endl;
+}
+
+void jacobi_generate_benchmark(int N, float target_accuracy, int max_iters, std::string device_type, uint64_t seed) {
+    auto start_time = std::chrono::steady_clock::now();
+    auto old_system = get_random_system(N);
+    auto end_time = std::chrono::steady_clock::now();
+    std::cout << "[Generate ] mt19937 host: " << std::chrono::duration<double, std::milli>(end_time - start_time).count() << " ms" << std::endl;
+
+    start_time = std::chrono::steady_clock::now();
+    auto host_system = get_random_system(N, seed);
+    end_time = std::chrono::steady_clock::now();
+    std::cout << "[Generate ] Philox host: " << std::chrono::duration<double, std::milli>(end_time - start_time).count() << " ms (seed " << seed << ")" << std::endl;
+
+    JacobiSession session(device_type, N, seed);
+    std::cout << "Target device: " << session.get_queue().get_device().get_info<sycl::info::device::name>() << " (" << layout_name(session.get_layout()) << ")" << std::endl;
+    std::cout << "[Generate ] Philox device session startup: " << session.get_startup_us() / 1000.0 << " ms (queue, generation, JIT)" << std::endl;
+
+    auto device_system = session.download_system();
+    convert_layout(host_system.first, N, session.get_layout());
+    bool identical = device_system.first == host_system.first && device_system.second == host_system.second;
+    std::cout << "[Generate ] Device and host systems are " << (identical ? "bit-identical" : "DIFFERENT") << std::endl;
+
+    std::vector<float> x = session.solve(host_system.second, target_accuracy, max_iters);
+    print_results(" Session ", {session.get_last_solve_us(), session.residual(host_system.second, x), session.get_last_accuracy_while(), session.get_last_iters()}, max_iters);
+}
+
+std::vector<float> jacobi_csr(float target_accuracy, int max_iters, std::string device_type, const CsrView& A, Span<const float> b, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+    HostRegistration registration(queue, A.values.data(), A.values.size()*sizeof(float));
+
+    int* row_ptr_device = sycl::malloc_device<int>(A.row_ptr.size(), queue);
+    int* col_idx_device = sycl::malloc_device<int>(A.col_idx.size(), queue);
+    float* values_device = sycl::malloc_device<float>(A.values.size(), queue);
+    float* b_device = sycl::malloc_device<float>(b.size(), queue);
+    float* xk_device = sycl::malloc_device<float>(b.size(), queue);
+    std::vector<float> xk1(b.begin(), b.end());
+    float* xk1_device = sycl::malloc_device<float>(xk1.size(), queue);
+    float* norms_device = sycl::malloc_device<float>(2, queue);
+
+    queue.memcpy(row_ptr_device, A.row_ptr.data(), A.row_ptr.size()*sizeof(int)).wait();
+    queue.memcpy(col_idx_device, A.col_idx.data(), A.col_idx.size()*sizeof(int)).wait();
+    queue.memcpy(values_device, A.values.data(), A.values.size()*sizeof(float)).wait();
+    queue.memcpy(b_device, b.data(), b.size()*sizeof(float)).wait();
+    queue.memset(xk_device, 0, b.size()*sizeof(float)).wait();
+    queue.memcpy(xk1_device, xk1.data(), xk1.size()*sizeof(float)).wait();
+
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    do {
+        iter_counter++;
+        std::swap(xk_device, xk1_device);
+        queue.parallel_for(sycl::range<1>(b.size()), [=](sycl::item<1> item) {
+            int i = item.get_id(0);
+            float sum = 0.0f;
+            float diag = 1.0f;
+            for (int k = row_ptr_device[i]; k < row_ptr_device[i + 1]; k++) {
+                int j = col_idx_device[k];
+                if (i != j) {
+                    sum += values_device[k] * xk_device[j];
+                } else {
+                    diag = values_device[k];
+                }
+            }
+            xk1_device[i] = (b_device[i] - sum) / diag;
+        }).wait();
+        accuracy = relative_accuracy_device(queue, xk_device, xk1_device, b.size(), norms_device);
+    } while (iter_counter < max_iters && accuracy > target_accuracy);
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    queue.memcpy(xk1.data(), xk1_device, xk1.size()*sizeof(float)).wait();
+    queue.parallel_for(sycl::range<1>(b.size()),
+        sycl::reduction(norms_device, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& result) {
+            int i = item.get_id(0);
+            float tmp = 0.0f - b_device[i];
+            for (int k = row_ptr_device[i]; k < row_ptr_device[i + 1]; k++) {
+                tmp += values_device[k] * xk1_device[col_idx_device[k]];
+            }
+            result += tmp * tmp;
+        }).wait();
+    float final_accuracy = 0.0f;
+    queue.memcpy(&final_accuracy, norms_device, sizeof(float)).wait();
+    final_accuracy = std::sqrt(final_accuracy);
+
+    sycl::free(row_ptr_device, queue);
+    sycl::free(col_idx_device, queue);
+    sycl::free(values_device, queue);
+    sycl::free(b_device, queue);
+    sycl::free(xk_device, queue);
+    sycl::free(xk1_device, queue);
+    sycl::free(norms_device, queue);
+
+    std::cout << "Target device: " << queue.get_device().get_info<sycl::info::device::name>() << " (nnz: " << A.values.size() << ")" << std::endl;
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("   CSR   ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+
+    return xk1;
+}
+
+std::vector<float> jacobi_ell(float target_accuracy, int max_iters, std::string device_type, const EllMatrix& A, std::vector<float> b, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+
+    int* col_idx_device = sycl::malloc_device<int>(A.col_idx.size(), queue);
+    float* values_device = sycl::malloc_device<float>(A.values.size(), queue);
+    float* b_device = sycl::malloc_device<float>(b.size(), queue);
+    float* xk_device = sycl::malloc_device<float>(b.size(), queue);
+    std::vector<float> xk1 = b;
+    float* xk1_device = sycl::malloc_device<float>(xk1.size(), queue);
+    float* norms_device = sycl::malloc_device<float>(2, queue);
+
+    queue.memcpy(col_idx_device, A.col_idx.data(), A.col_idx.size()*sizeof(int)).wait();
+    queue.memcpy(values_device, A.values.data(), A.values.size()*sizeof(float)).wait();
+    queue.memcpy(b_device, b.data(), b.size()*sizeof(float)).wait();
+    queue.memset(xk_device, 0, b.size()*sizeof(float)).wait();
+    queue.memcpy(xk1_device, xk1.data(), xk1.size()*sizeof(float)).wait();
+
+    const int width = A.width;
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    do {
+        iter_counter++;
+        std::swap(xk_device, xk1_device);
+        queue.parallel_for(sycl::range<1>(b.size()), [=](sycl::item<1> item) {
+            int i = item.get_id(0);
             int n = item.get_range(0);
             float sum = 0.0f;
-            for (int j = 0; j < n; j++) {
+            float diag = 1.0f;
+            for (int k = 0; k < width; k++) {
+                int j = col_idx_device[(size_t)k * n + i];
+                if (j < 0) {
+                    break;
+                }
                 if (i != j) {
-                    sum += A_device[i + j * n] * xk_device[j];
+                    sum += values_device[(size_t)k * n + i] * xk_device[j];
+                } else {
+                    diag = values_device[(size_t)k * n + i];
                 }
             }
-            xk1_device[i] = (b_device[i] - sum) / A_device[i + i * n];
+            xk1_device[i] = (b_device[i] - sum) / diag;
         }).wait();
-        queue.memcpy(xk.data(), xk_device, xk.size()*sizeof(float)).wait();
-        queue.memcpy(xk1.data(), xk1_device, xk1.size()*sizeof(float)).wait();
-        accuracy = relative_accuracy(xk, xk1);
+        accuracy = relative_accuracy_device(queue, xk_device, xk1_device, b.size(), norms_device);
     } while (iter_counter < max_iters && accuracy > target_accuracy);
 
     auto end_time = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
 
-    float final_accuracy = achived_accuracy(A, b, xk1);
+    queue.memcpy(xk1.data(), xk1_device, xk1.size()*sizeof(float)).wait();
+    queue.parallel_for(sycl::range<1>(b.size()),
+        sycl::reduction(norms_device, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+        [=](sycl::item<1> item, auto& result) {
+            int i = item.get_id(0);
+            int n = item.get_range(0);
+            float tmp = 0.0f - b_device[i];
+            for (int k = 0; k < width; k++) {
+                int j = col_idx_device[(size_t)k * n + i];
+                if (j < 0) {
+                    break;
+                }
+                tmp += values_device[(size_t)k * n + i] * xk1_device[j];
+            }
+            result += tmp * tmp;
+        }).wait();
+    float final_accuracy = 0.0f;
+    queue.memcpy(&final_accuracy, norms_device, sizeof(float)).wait();
+    final_accuracy = std::sqrt(final_accuracy);
 
-    sycl::free(A_device, queue);
+    sycl::free(col_idx_device, queue);
+    sycl::free(values_device, queue);
     sycl::free(b_device, queue);
     sycl::free(xk_device, queue);
     sycl::free(xk1_device, queue);
+    sycl::free(norms_device, queue);
 
-    print_results("  Device ", elapsed_ms.count(), final_accuracy, accuracy, iter_counter, max_iters);
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("   ELL   ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
 
     return xk1;
 }
 
-float* jacobi_seq(float* A, float* b, int n, float targetAcc, int maxIters) {
-    float accuracy = 0.0f;
-    int iter_counter = 0;
-    float* xk = new float[n];
-    float* xk1 = new float[n];
-    for (int i = 0; i < n; i++) {
-        xk1[i] = b[i];
-        xk[i] = 0.0f;
+enum class NativeSimd { Scalar, Avx2, Avx512 };
+
+// The host code is built without -mavx2 / -march (see build.bat), so the vector paths carry their
+// own target attributes and are picked once from CPUID, including the OS support for the registers
+NativeSimd detect_native_simd() {
+#ifdef NATIVE_SIMD_DISPATCH
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_OSXSAVE) || !(ecx & bit_AVX) || !(ecx & bit_FMA)) {
+        return NativeSimd::Scalar;
+    }
+    unsigned xcr0, xcr0_high;
+    __asm__("xgetbv" : "=a"(xcr0), "=d"(xcr0_high) : "c"(0));
+    if ((xcr0 & 0x6) != 0x6 || !__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) || !(ebx & bit_AVX2)) {
+        return NativeSimd::Scalar;
+    }
+    if ((ebx & bit_AVX512F) && (xcr0 & 0xe6) == 0xe6) {
+        return NativeSimd::Avx512;
+    }
+    return NativeSimd::Avx2;
+#else
+    return NativeSimd::Scalar;
+#endif
+}
+
+const NativeSimd native_simd = detect_native_simd();
+
+std::string native_simd_name() {
+    if (native_simd == NativeSimd::Avx512) {
+        return "AVX-512";
+    } else if (native_simd == NativeSimd::Avx2) {
+        return "AVX2";
+    }
+    return "scalar";
+}
+
+#ifdef NATIVE_SIMD_DISPATCH
+__attribute__((target("avx512f"))) float dot_avx512(const float* a, const float* x, int n) {
+    int j = 0;
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    for (; j + 32 <= n; j += 32) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j), _mm512_loadu_ps(x + j), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + j + 16), _mm512_loadu_ps(x + j + 16), acc1);
+    }
+    float sum = _mm512_reduce_add_ps(_mm512_add_ps(acc0, acc1));
+    for (; j < n; j++) {
+        sum += a[j] * x[j];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma"))) float dot_avx2(const float* a, const float* x, int n) {
+    int j = 0;
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    for (; j + 16 <= n; j += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j), _mm256_loadu_ps(x + j), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + j + 8), _mm256_loadu_ps(x + j + 8), acc1);
+    }
+    __m256 acc = _mm256_add_ps(acc0, acc1);
+    __m128 half_sum = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+    half_sum = _mm_add_ps(half_sum, _mm_movehl_ps(half_sum, half_sum));
+    half_sum = _mm_add_ss(half_sum, _mm_shuffle_ps(half_sum, half_sum, 1));
+    float sum = _mm_cvtss_f32(half_sum);
+    for (; j < n; j++) {
+        sum += a[j] * x[j];
+    }
+    return sum;
+}
+#endif
+
+inline float dot_native(const float* a, const float* x, int n) {
+#ifdef NATIVE_SIMD_DISPATCH
+    if (native_simd == NativeSimd::Avx512) {
+        return dot_avx512(a, x, n);
+    } else if (native_simd == NativeSimd::Avx2) {
+        return dot_avx2(a, x, n);
+    }
+#endif
+    float sum = 0.0f;
+    for (int j = 0; j < n; j++) {
+        sum += a[j] * x[j];
+    }
+    return sum;
+}
+
+class ThreadBarrier {
+public:
+    explicit ThreadBarrier(int count) : count(count) {}
+
+    void arrive_and_wait() {
+        std::unique_lock<std::mutex> lock(mutex);
+        int current_generation = generation;
+        if (++arrived == count) {
+            arrived = 0;
+            generation++;
+            condition.notify_all();
+        } else {
+            condition.wait(lock, [&] { return generation != current_generation; });
+        }
+    }
+
+private:
+    std::mutex mutex;
+    std::condition_variable condition;
+    int count;
+    int arrived = 0;
+    int generation = 0;
+};
+
+// Native CPU reference: row-major A, persistent threads pulling blocks of rows from a shared
+// counter, SIMD dot products and per-thread partial norms, so an iteration does not allocate
+std::vector<float> jacobi_native(int N, float target_accuracy, int max_iters, std::vector<float> A, std::vector<float> b, int thread_count, SolveStats* stats = nullptr) {
+    if (thread_count <= 0) {
+        thread_count = std::max(1u, std::thread::hardware_concurrency());
     }
+    convert_layout(A, N, Layout::RowMajor);
+
+    struct alignas(64) PartialNorms {
+        float top;
+        float bot;
+    };
+    const int block_rows = 64;
+    std::vector<float> x[2] = {std::vector<float>(N, 0.0f), b};
+    std::vector<PartialNorms> partial(thread_count);
+    std::atomic<int> next_block(0);
+    ThreadBarrier barrier(thread_count);
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+    bool done = false;
+
+    auto worker = [&](int t) {
+        while (true) {
+            const float* xk = x[(iter_counter + 1) % 2].data();
+            float* xk1 = x[iter_counter % 2].data();
+            float top = 0.0f;
+            float bot = 0.0f;
+            for (int block = next_block++; block * block_rows < N; block = next_block++) {
+                int row_end = std::min(N, (block + 1) * block_rows);
+                for (int i = block * block_rows; i < row_end; i++) {
+                    const float* row = A.data() + (size_t)i * N;
+                    float sum = dot_native(row, xk, i) + dot_native(row + i + 1, xk + i + 1, N - i - 1);
+                    xk1[i] = (b[i] - sum) / row[i];
+                    float tmp = xk[i] - xk1[i];
+                    top += tmp * tmp;
+                    bot += xk[i] * xk[i];
+                }
+            }
+            partial[t] = {top, bot};
+            barrier.arrive_and_wait();
+            if (t == 0) {
+                top = 0.0f;
+                bot = 0.0f;
+                for (const PartialNorms& p : partial) {
+                    top += p.top;
+                    bot += p.bot;
+                }
+                accuracy = std::sqrt(top) / std::sqrt(bot);
+                iter_counter++;
+                done = iter_counter >= max_iters || accuracy <= target_accuracy;
+                next_block = 0;
+            }
+            barrier.arrive_and_wait();
+            if (done) {
+                break;
+            }
+        }
+    };
+
     auto start_time = std::chrono::steady_clock::now();
-    do {
-        std::swap(xk, xk1);
-        iter_counter++;
-        for (int i = 0; i < n; i++) {
+
+    std::vector<std::thread> threads;
+    for (int t = 1; t < thread_count; t++) {
+        threads.emplace_back(worker, t);
+    }
+    worker(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    auto end_time = std::chrono::steady_clock::now();
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    std::vector<float>& xk1 = x[(iter_counter - 1) % 2];
+    float final_accuracy = 0.0f;
+    for (int i = 0; i < N; i++) {
+        float tmp = dot_native(A.data() + (size_t)i * N, xk1.data(), N) - b[i];
+        final_accuracy += tmp * tmp;
+    }
+    final_accuracy = std::sqrt(final_accuracy);
+
+    std::cout << "Native engine: " << thread_count << " threads, " << native_simd_name() << std::endl;
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results(" Native  ", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    return xk1;
+}
+
+template <typename TileT>
+sycl::event jacobi_sweep_tile(sycl::queue& queue, const TileT* tile, const float* diag, const float* b, const float* xk, float* xk1, int first_row, int rows, int n, const std::vector<sycl::event>& dependencies) {
+    return queue.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(dependencies);
+        cgh.parallel_for(sycl::range<1>(rows), [=](sycl::item<1> item) {
+            int r = item.get_id(0);
+            int i = first_row + r;
+            const TileT* row = tile + (size_t)r * n;
             float sum = 0.0f;
-            for (int j = 0; j < n; j++) {
-                if (i != j) {
-                    sum += A[j * n + i] * xk[j];
-                }  
+            for (int j = 0; j < i; j++) {
+                sum += static_cast<float>(row[j]) * xk[j];
+            }
+            for (int j = i + 1; j < n; j++) {
+                sum += static_cast<float>(row[j]) * xk[j];
+            }
+            xk1[i] = (b[i] - sum) / diag[i];
+        });
+    });
+}
+
+template <typename TileT>
+sycl::event residual_tile(sycl::queue& queue, const TileT* tile, const float* diag, const float* b, const float* x, int first_row, int rows, int n, float* partial, const std::vector<sycl::event>& dependencies) {
+    return queue.submit([&](sycl::handler &cgh) {
+        cgh.depends_on(dependencies);
+        cgh.parallel_for(sycl::range<1>(rows),
+            sycl::reduction(partial, sycl::plus<float>(), {sycl::property::reduction::initialize_to_identity()}),
+            [=](sycl::item<1> item, auto& result) {
+                int r = item.get_id(0);
+                int i = first_row + r;
+                const TileT* row = tile + (size_t)r * n;
+                float tmp = diag[i] * x[i] - b[i];
+                for (int j = 0; j < i; j++) {
+                    tmp += static_cast<float>(row[j]) * x[j];
+                }
+                for (int j = i + 1; j < n; j++) {
+                    tmp += static_cast<float>(row[j]) * x[j];
+                }
+                result += tmp * tmp;
+            });
+    });
+}
+
+// Out-of-core Jacobi: A is split into blocks of block_rows rows. As many blocks as the memory budget
+// allows stay resident on the device, the rest lives in pinned host memory (as TileT, so sycl::half
+// halves the transfer) and is streamed through two staging buffers: the copy of block k + 1 runs while
+// the kernel works on block k. The diagonal is kept apart in float
+template <typename TileT>
+std::vector<float> jacobi_streaming(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, size_t budget_bytes, int block_rows, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+    if (budget_bytes == 0) {
+        budget_bytes = queue.get_device().get_info<sycl::info::device::global_mem_size>() / 10 * 8;
+    }
+    size_t max_alloc = queue.get_device().get_info<sycl::info::device::max_mem_alloc_size>();
+
+    convert_layout(A, N, Layout::RowMajor);
+    block_rows = std::max(1, std::min(block_rows, N));
+    int block_count = (N + block_rows - 1) / block_rows;
+    size_t block_elems = (size_t)block_rows * N;
+    size_t staging_bytes = 2 * block_elems * sizeof(TileT);
+    size_t resident_budget = std::min(budget_bytes > staging_bytes ? budget_bytes - staging_bytes : 0, max_alloc);
+    int resident_blocks = std::min<size_t>(block_count, resident_budget / (block_elems * sizeof(float)));
+    if (resident_blocks < block_count && budget_bytes < staging_bytes) {
+        std::cout << "Memory budget is smaller than two staging blocks" << std::endl;
+        return {};
+    }
+    int resident_rows = std::min(N, resident_blocks * block_rows);
+    bool streaming = resident_blocks < block_count;
+
+    std::vector<float> diag(N);
+    for (int i = 0; i < N; i++) {
+        diag[i] = A[(size_t)i * N + i];
+    }
+
+    float* A_resident = sycl::malloc_device<float>(std::max<size_t>((size_t)resident_rows * N, 1), queue);
+    queue.memcpy(A_resident, A.data(), (size_t)resident_rows * N * sizeof(float)).wait();
+    TileT* A_host = nullptr;
+    TileT* staging[2] = {nullptr, nullptr};
+    if (streaming) {
+        size_t cold_elems = (size_t)(N - resident_rows) * N;
+        A_host = sycl::malloc_host<TileT>(cold_elems, queue);
+        for (size_t index = 0; index < cold_elems; index++) {
+            A_host[index] = static_cast<TileT>(A[(size_t)resident_rows * N + index]);
+        }
+        for (int i = resident_rows; i < N; i++) {
+            A_host[(size_t)(i - resident_rows) * N + i] = static_cast<TileT>(0.0f);
+        }
+        staging[0] = sycl::malloc_device<TileT>(block_elems, queue);
+        staging[1] = sycl::malloc_device<TileT>(block_elems, queue);
+    }
+    std::vector<float>().swap(A);
+
+    float* diag_device = sycl::malloc_device<float>(N, queue);
+    float* b_device = sycl::malloc_device<float>(N, queue);
+    float* xk_device = sycl::malloc_device<float>(N, queue);
+    float* xk1_device = sycl::malloc_device<float>(N, queue);
+    float* norms_device = sycl::malloc_device<float>(2, queue);
+    float* residual_device = sycl::malloc_device<float>(block_count, queue);
+    queue.memcpy(diag_device, diag.data(), N*sizeof(float));
+    queue.memcpy(b_device, b.data(), N*sizeof(float));
+    queue.memcpy(xk1_device, b.data(), N*sizeof(float));
+    queue.wait();
+
+    // Runs launch(tile, block, first_row, rows, dependencies) over all blocks, feeding the streamed
+    // ones through the staging buffers, and returns the kernel events
+    auto stream_pass = [&](auto launch) {
+        std::vector<sycl::event> kernel_events;
+        std::vector<sycl::event> staging_busy[2];
+        for (int block = 0; block < block_count; block++) {
+            int first_row = block * block_rows;
+            int rows = std::min(block_rows, N - first_row);
+            if (block < resident_blocks) {
+                kernel_events.push_back(launch(A_resident + (size_t)first_row * N, block, first_row, rows, std::vector<sycl::event>{}));
+                continue;
             }
-            xk1[i] = (1.0f / A[i * n + i]) * (b[i] - sum);
+            int slot = block % 2;
+            sycl::event copy_event = queue.memcpy(staging[slot], A_host + (size_t)(first_row - resident_rows) * N, (size_t)rows * N * sizeof(TileT), staging_busy[slot]);
+            sycl::event kernel_event = launch(staging[slot], block, first_row, rows, std::vector<sycl::event>{copy_event});
+            staging_busy[slot] = {kernel_event};
+            kernel_events.push_back(kernel_event);
         }
-        accuracy = relative_accuracy(std::vector(xk, xk+n), std::vector(xk1, xk1+n));
-    } while (iter_counter < maxIters && accuracy > targetAcc);
+        return kernel_events;
+    };
+
+    int iter_counter = 0;
+    float accuracy = 0.0f;
+
+    auto start_time = std::chrono::steady_clock::now();
+
+    do {
+        iter_counter++;
+        std::swap(xk_device, xk1_device);
+        std::vector<sycl::event> events = stream_pass([&](const auto* tile, int block, int first_row, int rows, const std::vector<sycl::event>& dependencies) {
+            return jacobi_sweep_tile(queue, tile, diag_device, b_device, xk_device, xk1_device, first_row, rows, N, dependencies);
+        });
+        sycl::event::wait(events);
+        accuracy = relative_accuracy_device(queue, xk_device, xk1_device, N, norms_device);
+    } while (iter_counter < max_iters && accuracy > target_accuracy);
+
     auto end_time = std::chrono::steady_clock::now();
-    auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time);
-    float final_accuracy = achived_accuracy(std::vector<float>(A, A+n*n), std::vector<float>(b, b+n), std::vector<float>(xk1, xk1+n));
-    print_results(" Seq cpu ", elapsed_ms.count(), final_accuracy, accuracy, iter_counter, maxIters);
+    auto elapsed_us = std::chrono::duration_cast<std::chrono::microseconds>(end_time - start_time);
+
+    std::vector<sycl::event> events = stream_pass([&](const auto* tile, int block, int first_row, int rows, const std::vector<sycl::event>& dependencies) {
+        return residual_tile(queue, tile, diag_device, b_device, xk1_device, first_row, rows, N, residual_device + block, dependencies);
+    });
+    sycl::event::wait(events);
+    std::vector<float> residual(block_count);
+    queue.memcpy(residual.data(), residual_device, block_count*sizeof(float)).wait();
+    float final_accuracy = std::sqrt(std::accumulate(residual.begin(), residual.end(), 0.0f));
+
+    std::vector<float> xk1(N);
+    queue.memcpy(xk1.data(), xk1_device, N*sizeof(float)).wait();
+
+    sycl::free(A_resident, queue);
+    sycl::free(A_host, queue);
+    sycl::free(staging[0], queue);
+    sycl::free(staging[1], queue);
+    sycl::free(diag_device, queue);
+    sycl::free(b_device, queue);
+    sycl::free(xk_device, queue);
+    sycl::free(xk1_device, queue);
+    sycl::free(norms_device, queue);
+    sycl::free(residual_device, queue);
+
+    double streamed_mb = (double)(N - resident_rows) * N * sizeof(TileT) / (1024 * 1024);
+    std::cout << "Target device: " << queue.get_device().get_info<sycl::info::device::name>() << " budget: " << budget_bytes / (1024 * 1024) << " MB" << std::endl;
+    SolveStats result = {elapsed_us.count(), final_accuracy, accuracy, iter_counter};
+    print_results("Streaming", result, max_iters);
+    if (stats != nullptr) {
+        *stats = result;
+    }
+    std::cout << "[Streaming] Resident rows: " << resident_rows << " / " << N << " Streamed per sweep: " << streamed_mb << " MB ("
+              << sizeof(TileT) * 8 << "-bit tiles), " << streamed_mb * iter_counter / 1024 / std::max(elapsed_us.count() * 1e-6, 1e-9) << " GB/s" << std::endl;
+
     return xk1;
 }
 
+struct Args {
+    int N;
+    float target_accuracy;
+    int max_iters;
+    std::string device;
+    std::string variant = "dense";
+    std::map<std::string, std::string> options;
+};
+
+Args parse_args(int argc, char* argv[]) {
+    Args args;
+    try {
+        if (argc < 5) throw -1;
+        args.N = atoi(argv[1]);
+        if (args.N <= 0) throw -1;
+        args.target_accuracy = std::stof(argv[2]);
+        args.max_iters = atoi(argv[3]);
+        args.device = argv[4];
+        if (argc > 5) args.variant = argv[5];
+        for (int i = 6; i < argc; i++) {
+            std::string option = argv[i];
+            size_t eq = option.find('=');
+            if (eq == std::string::npos) throw -1;
+            args.options[option.substr(0, eq)] = option.substr(eq + 1);
+        }
+    } catch (...) {
+        std::cout << "Args error. Expected: N, accuracy, maxiters, device, [variant], [key=value ...]" << std::endl;
+        exit(-1);
+    }
+    return args;
+}
+
+double get_option(const Args& args, const std::string& key, double default_value) {
+    auto it = args.options.find(key);
+    return it == args.options.end() ? default_value : std::stod(it->second);
+}
+
+std::vector<std::string> get_list_option(const Args& args, const std::string& key, const std::string& default_value) {
+    auto it = args.options.find(key);
+    std::stringstream list(it == args.options.end() ? default_value : it->second);
+    std::vector<std::string> values;
+    std::string value;
+    while (std::getline(list, value, ',')) {
+        if (!value.empty()) {
+            values.push_back(value);
+        }
+    }
+    return values;
+}
+
+struct BenchmarkResult {
+    std::string variant;
+    std::string device;
+    std::string device_name;
+    int N;
+    int reps;
+    int iters;
+    float accuracy;
+    double min_us;
+    double median_us;
+    double p95_us;
+    double wall_median_us;
+};
+
+double percentile(std::vector<double> values, double p) {
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)std::ceil(p * values.size());
+    return values[std::min(values.size() - 1, index > 0 ? index - 1 : 0)];
+}
+
+// Swallows std::cout while warm-up and timed runs print their own results
+class SilenceOutput {
+public:
+    SilenceOutput() : old_buffer(std::cout.rdbuf(sink.rdbuf())) {}
+    ~SilenceOutput() { std::cout.rdbuf(old_buffer); }
+private:
+    std::ostringstream sink;
+    std::streambuf* old_buffer;
+};
+
+// Best configuration found for a device and size bucket. variant is accessors, shared, device or
+// group; layout and group_size (0 = runtime's choice) apply to the device and group kernels
+struct TunedConfig {
+    std::string variant = "device";
+    Layout layout = Layout::ColMajor;
+    int group_size = 0;
+    double iter_us = 0.0;
+};
+
+// Tuning results are shared by all N up to the next power of two
+int size_bucket(int N) {
+    int bucket = 1;
+    while (bucket < N) {
+        bucket *= 2;
+    }
+    return bucket;
+}
+
+// Tab-separated cache file, one line per device and bucket:
+// device name, bucket, variant, layout (row / col), work-group size, time per iteration in us
+class TuningCache {
+public:
+    explicit TuningCache(std::string path) : path(path) {
+        std::ifstream in(path);
+        std::string line;
+        while (std::getline(in, line)) {
+            std::istringstream fields(line);
+            std::string device, bucket, variant, layout, group_size, iter_us;
+            std::getline(fields, device, '\t');
+            std::getline(fields, bucket, '\t');
+            std::getline(fields, variant, '\t');
+            std::getline(fields, layout, '\t');
+            std::getline(fields, group_size, '\t');
+            if (!std::getline(fields, iter_us)) {
+                continue;
+            }
+            try {
+                entries[{device, std::stoi(bucket)}] = {variant, layout == "row" ? Layout::RowMajor : Layout::ColMajor, std::stoi(group_size), std::stod(iter_us)};
+            } catch (...) {
+                continue;
+            }
+        }
+    }
+
+    bool find(const std::string& device, int bucket, TunedConfig& config) const {
+        auto it = entries.find({device, bucket});
+        if (it == entries.end()) {
+            return false;
+        }
+        config = it->second;
+        return true;
+    }
+
+    void store(const std::string& device, int bucket, const TunedConfig& config) {
+        entries[{device, bucket}] = config;
+        std::ofstream out(path);
+        for (const auto& entry : entries) {
+            const TunedConfig& c = entry.second;
+            out << entry.first.first << '\t' << entry.first.second << '\t' << c.variant << '\t' << (c.layout == Layout::RowMajor ? "row" : "col")
+                << '\t' << c.group_size << '\t' << c.iter_us << '\n';
+        }
+    }
+
+private:
+    std::string path;
+    std::map<std::pair<std::string, int>, TunedConfig> entries;
+};
+
+// Stage 1 ranks kernel configurations by the median of `reps` profiled sweeps on a system generated
+// on the device: the plain sweep for both layouts and all work-group sizes, the sub-group kernel
+// (row-major, as in jacobi_group) for several work-group sizes. Stage 2 compares the winner with the
+// buffer and shared USM versions by the cost of extra iterations: after a warm-up solve each variant
+// runs reps and 3 * reps iterations, and the difference cancels uploads and JIT that the buffer
+// version pays inside its timed loop
+TunedConfig tune_jacobi(int N, std::string device_type, int reps) {
+    sycl::queue queue = create_queue(device_type);
+    int max_group_size = queue.get_device().get_info<sycl::info::device::max_work_group_size>();
+    const uint64_t seed = 42;
+
+    float* A_device = sycl::malloc_device<float>((size_t)N * N, queue);
+    float* b_device = sycl::malloc_device<float>(N, queue);
+    float* xk_device = sycl::malloc_device<float>(N, queue);
+    float* xk1_device = sycl::malloc_device<float>(N, queue);
+    queue.memset(xk_device, 0, N*sizeof(float)).wait();
+
+    auto time_kernel = [&](auto launch) {
+        launch().wait();
+        std::vector<double> times;
+        for (int r = 0; r < reps; r++) {
+            sycl::event event = launch();
+            event.wait();
+            times.push_back((event.get_profiling_info<sycl::info::event_profiling::command_end>() - event.get_profiling_info<sycl::info::event_profiling::command_start>()) / 1000.0);
+        }
+        return percentile(times, 0.5);
+    };
+
+    std::vector<TunedConfig> candidates;
+    for (Layout layout : {Layout::RowMajor, Layout::ColMajor}) {
+        if (layout == Layout::RowMajor) {
+            generate_system_device<Layout::RowMajor>(queue, A_device, b_device, N, seed).wait();
+        } else {
+            generate_system_device<Layout::ColMajor>(queue, A_device, b_device, N, seed).wait();
+        }
+        for (int group_size : {0, 32, 64, 128, 256, 512, 1024}) {
+            if (group_size > max_group_size) {
+                continue;
+            }
+            double us = time_kernel([&]() { return jacobi_sweep(queue, layout, A_device, b_device, xk_device, xk1_device, N, group_size); });
+            candidates.push_back({"device", layout, group_size, us});
+        }
+        if (layout == Layout::RowMajor) {
+            for (int group_size : {64, 128, 256, 512}) {
+                if (group_size > max_group_size) {
+                    continue;
+                }
+                int rows_per_group = group_rows(queue.get_device(), group_size);
+                double us = time_kernel([&]() { return jacobi_sweep_group<Layout::RowMajor>(queue, A_device, b_device, xk_device, xk1_device, N, group_size, rows_per_group, 1024); });
+                candidates.push_back({"group", layout, group_size, us});
+            }
+        }
+    }
+
+    sycl::free(A_device, queue);
+    sycl::free(b_device, queue);
+    sycl::free(xk_device, queue);
+    sycl::free(xk1_device, queue);
+
+    for (const TunedConfig& c : candidates) {
+        std::cout << "[  Tune   ] " << c.variant << " " << layout_name(c.layout) << " wg " << c.group_size << ": " << c.iter_us << " us per sweep" << std::endl;
+    }
+    TunedConfig best = *std::min_element(candidates.begin(), candidates.end(), [](const TunedConfig& l, const TunedConfig& r) { return l.iter_us < r.iter_us; });
+
+    auto system = get_random_system(N, seed);
+    auto run_solve = [&](const TunedConfig& config, int iters) {
+        SolveStats stats;
+        SilenceOutput silence;
+        if (config.variant == "accessors") {
+            jacobi_accessors(N, 0.0f, iters, device_type, system.first, system.second, false, &stats);
+        } else if (config.variant == "shared") {
+            jacobi_shared_mem(N, 0.0f, iters, device_type, system.first, system.second, false, &stats);
+        } else if (config.variant == "group") {
+            jacobi_group(N, 0.0f, iters, device_type, system.first, system.second, config.group_size, 1024, &stats);
+        } else {
+            std::vector<float> A = system.first;
+            convert_layout(A, N, config.layout);
+            jacobi_device_mem(queue, N, 0.0f, iters, A, system.second, config.layout, false, config.group_size, &stats);
+        }
+        return stats;
+    };
+    auto time_solve = [&](const TunedConfig& config) {
+        run_solve(config, 1);
+        SolveStats short_run = run_solve(config, reps);
+        SolveStats long_run = run_solve(config, 3 * reps);
+        if (short_run.iters == 0 || long_run.iters <= short_run.iters) {
+            std::cout << "[  Tune   ] " << config.variant << " solve did not report, skipped" << std::endl;
+            return std::numeric_limits<double>::infinity();
+        }
+        double us = (double)(long_run.time_us - short_run.time_us) / (long_run.iters - short_run.iters);
+        std::cout << "[  Tune   ] " << config.variant << " solve: " << us << " us per iteration" << std::endl;
+        return us;
+    };
+    Layout preferred = preferred_layout(queue.get_device());
+    best.iter_us = time_solve(best);
+    for (std::string variant : {"accessors", "shared"}) {
+        TunedConfig config = {variant, preferred, 0, 0.0};
+        config.iter_us = time_solve(config);
+        if (config.iter_us < best.iter_us) {
+            best = config;
+        }
+    }
+    return best;
+}
+
+// Solves with the configuration cached for this device and size bucket, tuning first on a miss
+std::vector<float> jacobi_tuned(int N, float target_accuracy, int max_iters, std::string device_type, std::vector<float> A, std::vector<float> b, std::string cache_path, bool retune, int reps, SolveStats* stats = nullptr) {
+    sycl::queue queue = create_queue(device_type);
+    std::string device_name = queue.get_device().get_info<sycl::info::device::name>();
+    TuningCache cache(cache_path);
+    TunedConfig config;
+    bool cached = !retune && cache.find(device_name, size_bucket(N), config);
+    if (!cached) {
+        config = tune_jacobi(N, device_type, reps);
+        cache.store(device_name, size_bucket(N), config);
+    }
+    std::cout << "Target device: " << device_name << " (" << (cached ? "cached" : "tuned") << ": " << config.variant << ", " << layout_name(config.layout)
+              << ", wg " << config.group_size << ")" << std::endl;
+
+    if (config.variant == "accessors") {
+        return jacobi_accessors(N, target_accuracy, max_iters, device_type, A, b, false, stats);
+    } else if (config.variant == "shared") {
+        return jacobi_shared_mem(N, target_accuracy, max_iters, device_type, A, b, false, stats);
+    } else if (config.variant == "group") {
+        return jacobi_group(N, target_accuracy, max_iters, device_type, A, b, config.group_size, 1024, stats);
+    }
+    convert_layout(A, N, config.layout);
+    return jacobi_device_mem(queue, N, target_accuracy, max_iters, A, b, config.layout, false, config.group_size, stats);
+}
+
+// Solve time is the one reported by the solver (iterations only), wall time also covers
+// queue creation, uploads and JIT of a stand-alone call
+void jacobi_benchmark(const Args& args) {
+    std::vector<std::string> sizes = get_list_option(args, "sizes", std::to_string(args.N));
+    std::vector<std::string> devices = get_list_option(args, "devices", args.device);
+    std::vector<std::string> variants = get_list_option(args, "variants", "accessors,shared,device,group,native");
+    int reps = std::max(1, (int)get_option(args, "reps", 5));
+    int warmup = get_option(args, "warmup", 1);
+    float target_accuracy = args.target_accuracy;
+    int max_iters = args.max_iters;
+
+    std::vector<BenchmarkResult> results;
+    for (const std::string& size : sizes) {
+        int N = std::stoi(size);
+        auto system = args.options.count("seed") ? get_random_system(N, std::stoull(args.options.at("seed"))) : get_random_system(N);
+        auto sparse_system = get_random_sparse_system(N, get_option(args, "nnz", 16));
+        for (const std::string& device : devices) {
+            std::string device_name = create_queue(device).get_device().get_info<sycl::info::device::name>();
+            for (const std::string& variant : variants) {
+                if (variant == "native" && device != devices.front()) {
+                    continue;
+                }
+                std::unique_ptr<JacobiSession> session;
+                if (variant == "session" || variant == "pipelined") {
+                    SilenceOutput silence;
+                    session = std::make_unique<JacobiSession>(device, system.first, N);
+                }
+                auto run = [&](SolveStats* stats) {
+                    SilenceOutput silence;
+                    if (variant == "accessors") {
+                        jacobi_accessors(N, target_accuracy, max_iters, device, system.first, system.second, false, stats);
+                    } else if (variant == "shared") {
+                        jacobi_shared_mem(N, target_accuracy, max_iters, device, system.first, system.second, false, stats);
+                    } else if (variant == "device") {
+                        jacobi_device_mem(N, target_accuracy, max_iters, device, system.first, system.second, false, stats);
+                    } else if (variant == "group") {
+                        jacobi_group(N, target_accuracy, max_iters, device, system.first, system.second, get_option(args, "wg", 256), get_option(args, "tile", 1024), stats);
+                    } else if (variant == "native") {
+                        jacobi_native(N, target_accuracy, max_iters, system.first, system.second, get_option(args, "threads", 0), stats);
+                    } else if (variant == "mixed") {
+                        jacobi_mixed(N, target_accuracy, max_iters, device, system.first, system.second, get_option(args, "refine", 1e-10), get_option(args, "outer", 10), true, stats);
+                    } else if (variant == "tuned") {
+                        jacobi_tuned(N, target_accuracy, max_iters, device, system.first, system.second, args.options.count("tune_cache") ? args.options.at("tune_cache") : "jacobi_tune.cache", false, get_option(args, "tune_reps", 5), stats);
+                    } else if (variant == "weighted" || variant == "redblack" || variant == "chebyshev") {
+                        jacobi_accelerated(N, target_accuracy, max_iters, device, system.first, system.second, variant, get_option(args, "lmin", NAN), get_option(args, "lmax", NAN), get_option(args, "omega", 0), stats);
+                    } else if (variant == "csr") {
+                        jacobi_csr(target_accuracy, max_iters, device, sparse_system.first, sparse_system.second, stats);
+                    } else if (variant == "ell") {
+                        jacobi_ell(target_accuracy, max_iters, device, csr_to_ell(sparse_system.first), sparse_system.second, stats);
+                    } else if (variant == "session" || variant == "pipelined") {
+                        std::vector<float> x = variant == "session"
+                            ? session->solve(system.second, target_accuracy, max_iters)
+                            : session->solve_pipelined(system.second, target_accuracy, max_iters, get_option(args, "interval", 0), get_option(args, "overlap", 1) != 0);
+                        SolveStats result = {session->get_last_solve_us(), session->residual(system.second, x), session->get_last_accuracy_while(), session->get_last_iters()};
+                        print_results(variant, result, max_iters);
+                        if (stats != nullptr) {
+                            *stats = result;
+                        }
+                    } else {
+                        return false;
+                    }
+                    return true;
+                };
+
+                for (int w = 0; w < warmup; w++) {
+                    run(nullptr);
+                }
+                std::vector<double> solve_us, wall_us;
+                bool known_variant = true;
+                bool reported = true;
+                SolveStats stats;
+                for (int r = 0; r < reps && known_variant && reported; r++) {
+                    stats = SolveStats();
+                    // A solver that returns early (e.g. mixed without fp64) leaves stats untouched
+                    auto start_time = std::chrono::steady_clock::now();
+                    known_variant = run(&stats);
+                    auto end_time = std::chrono::steady_clock::now();
+                    reported = stats.iters > 0;
+                    solve_us.push_back(stats.time_us);
+                    wall_us.push_back(std::chrono::duration<double, std::micro>(end_time - start_time).count());
+                }
+                if (!known_variant) {
+                    std::cout << "Unknown benchmark variant: " << variant << std::endl;
+                    continue;
+                }
+                if (!reported) {
+                    std::cout << "[" << variant << "] " << device << " N: " << N << " did not report a result, skipped" << std::endl;
+                    continue;
+                }
+
+                BenchmarkResult result = {variant, variant == "native" ? "host" : device, device_name, N, reps, stats.iters, stats.accuracy,
+                                          percentile(solve_us, 0.0), percentile(solve_us, 0.5), percentile(solve_us, 0.95), percentile(wall_us, 0.5)};
+                std::cout << "[" << result.variant << "] " << result.device << " N: " << N << " min: " << result.min_us << " us median: " << result.median_us
+                          << " us p95: " << result.p95_us << " us (wall median: " << result.wall_median_us << " us) Iters: " << result.iters << std::endl;
+                results.push_back(result);
+            }
+        }
+    }
+
+    if (args.options.count("csv")) {
+        std::ofstream csv(args.options.at("csv"));
+        csv << "variant,device,device_name,n,reps,iters,accuracy,min_us,median_us,p95_us,wall_median_us" << std::endl;
+        for (const BenchmarkResult& r : results) {
+            csv << r.variant << "," << r.device << ",\"" << r.device_name << "\"," << r.N << "," << r.reps << "," << r.iters << "," << r.accuracy << ","
+                << r.min_us << "," << r.median_us << "," << r.p95_us << "," << r.wall_median_us << std::endl;
+        }
+    }
+    if (args.options.count("json")) {
+        std::ofstream json(args.options.at("json"));
+        json << "[" << std::endl;
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchmarkResult& r = results[i];
+            json << "  {\"variant\": \"" << r.variant << "\", \"device\": \"" << r.device << "\", \"device_name\": \"" << r.device_name << "\", \"n\": " << r.N
+                 << ", \"reps\": " << r.reps << ", \"iters\": " << r.iters << ", \"accuracy\": " << r.accuracy << ", \"min_us\": " << r.min_us
+                 << ", \"median_us\": " << r.median_us << ", \"p95_us\": " << r.p95_us << ", \"wall_median_us\": " << r.wall_median_us << "}"
+                 << (i + 1 < results.size() ? "," : "") << std::endl;
+        }
+        json << "]" << std::endl;
+    }
+}
+
 int main(int argc, char* argv[]) {
-    if (argc != 5) {std::cout << "Args error. Expected: N, accuracy, maxiters, device" << std::endl; exit(-1);}
-    int N = atoi(argv[1]);
-    float target_accuracy = std::stof(argv[2]);
-    int max_iters = atoi(argv[3]);
-    std::string device = argv[4];
-
-    auto system = get_random_system(N);
-    auto res_accessors = jacobi_accessors(N, target_accuracy, max_iters, device, system.first, system.second);
-    auto res_shared_mem = jacobi_shared_mem(N, target_accuracy, max_iters, device, system.first, system.second);
-    auto res_device_mem = jacobi_device_mem(N, target_accuracy, max_iters, device, system.first, system.second);
-    //auto res_seq = jacobi_seq(system.first.data(), system.second.data(), N, target_accuracy, max_iters);
-    assert(res_accessors == res_shared_mem);
-    assert(res_accessors == res_device_mem);
+    Args args = parse_args(argc, argv);
+    int N = args.N;
+    float target_accuracy = args.target_accuracy;
+    int max_iters = args.max_iters;
+    std::string device = args.device;
+    // seed=S makes the dense system reproducible (counter-based generator), otherwise it is time-seeded
+    auto make_system = [&]() {
+        if (args.options.count("seed")) {
+            return get_random_system(N, std::stoull(args.options.at("seed")));
+        }
+        return get_random_system(N);
+    };
+
+    // file=path.mtx is read into CSR, any other file is mapped as a binary system and solved in place;
+    // N is taken from the file
+    if (args.options.count("file")) {
+        std::string path = args.options.at("file");
+        if (path.size() > 4 && path.substr(path.size() - 4) == ".mtx") {
+            auto system = read_matrix_market(path);
+            if (args.options.count("save")) {
+                write_system_file(args.options.at("save"), system.first, system.second);
+            }
+            jacobi_csr(target_accuracy, max_iters, device, system.first, system.second);
+            return 0;
+        }
+        MappedSystem system = map_system_file(path);
+        int n = (int)system.header.n;
+        if (system.header.format == SystemFormat::Csr) {
+            jacobi_csr(target_accuracy, max_iters, device, system.csr, system.b);
+        } else {
+            sycl::queue queue = create_queue(device);
+            std::cout << "Target device: " << queue.get_device().get_info<sycl::info::device::name>() << " (" << layout_name(system.layout) << ")" << std::endl;
+            jacobi_device_mem(queue, n, target_accuracy, max_iters, system.A, system.b, system.layout, get_option(args, "profile", 0) != 0);
+        }
+        return 0;
+    }
+
+    if (args.variant == "csr" || args.variant == "ell" || args.variant == "sparse") {
+        int nnz_per_row = get_option(args, "nnz", 16);
+        auto system = get_random_sparse_system(N, nnz_per_row);
+        if (args.options.count("save")) {
+            write_system_file(args.options.at("save"), system.first, system.second);
+        }
+        std::vector<float> res_csr, res_ell;
+        if (args.variant != "ell") {
+            res_csr = jacobi_csr(target_accuracy, max_iters, device, system.first, system.second);
+        }
+        if (args.variant != "csr") {
+            res_ell = jacobi_ell(target_accuracy, max_iters, device, csr_to_ell(system.first), system.second);
+        }
+        if (args.variant == "sparse") {
+            assert(res_csr == res_ell);
+        }
+        return 0;
+    }
+    if (args.variant == "bench") {
+        jacobi_benchmark(args);
+        return 0;
+    }
+
+    if (args.variant == "multi") {
+        auto system = make_system();
+        jacobi_multi_device(N, target_accuracy, max_iters, device, system.first, system.second);
+        return 0;
+    }
+
+    if (args.variant == "stream") {
+        auto system = make_system();
+        size_t budget_bytes = (size_t)(get_option(args, "budget_mb", 0) * 1024 * 1024);
+        int block_rows = get_option(args, "block", 256);
+        if (get_option(args, "compress", 0) != 0) {
+            jacobi_streaming<sycl::half>(N, target_accuracy, max_iters, device, system.first, system.second, budget_bytes, block_rows);
+        } else {
+            jacobi_streaming<float>(N, target_accuracy, max_iters, device, system.first, system.second, budget_bytes, block_rows);
+        }
+        return 0;
+    }
+
+    if (args.variant == "generate") {
+        jacobi_generate_benchmark(N, target_accuracy, max_iters, device, args.options.count("seed") ? std::stoull(args.options.at("seed")) : 42);
+        return 0;
+    }
+
+    if (args.variant == "session") {
+        auto system = make_system();
+        jacobi_session_benchmark(N, target_accuracy, max_iters, device, system.first, get_option(args, "solves", 10));
+        return 0;
+    }
+
+    if (args.variant == "batch") {
+        auto system = make_system();
+        jacobi_batch_benchmark(N, target_accuracy, max_iters, device, system.first, get_option(args, "rhs", 8));
+        return 0;
+    }
+
+    if (args.variant == "mixed") {
+        auto system = make_system();
+        bool half_storage = args.options.count("storage") == 0 || args.options.at("storage") == "half";
+        jacobi_device_mem(N, target_accuracy, max_iters, device, system.first, system.second);
+        jacobi_mixed(N, target_accuracy, max_iters, device, system.first, system.second, get_option(args, "refine", 1e-10), get_option(args, "outer", 10), half_storage);
+        return 0;
+    }
+
+    if (args.variant == "weighted" || args.variant == "redblack" || args.variant == "chebyshev" || args.variant == "accelerated") {
+        auto system = make_system();
+        float lambda_min = get_option(args, "lmin", NAN);
+        float lambda_max = get_option(args, "lmax", NAN);
+        float omega = get_option(args, "omega", 0);
+        if (args.variant == "accelerated") {
+            jacobi_device_mem(N, target_accuracy, max_iters, device, system.first, system.second);
+            for (std::string method : {"weighted", "redblack", "chebyshev"}) {
+                jacobi_accelerated(N, target_accuracy, max_iters, device, system.first, system.second, method, lambda_min, lambda_max, omega);
+            }
+        } else {
+            jacobi_accelerated(N, target_accuracy, max_iters, device, system.first, system.second, args.variant, lambda_min, lambda_max, omega);
+        }
+        return 0;
+    }
+
+    if (args.variant == "tuned") {
+        auto system = make_system();
+        std::string cache_path = args.options.count("tune_cache") ? args.options.at("tune_cache") : "jacobi_tune.cache";
+        jacobi_tuned(N, target_accuracy, max_iters, device, system.first, system.second, cache_path, get_option(args, "retune", 0) != 0, get_option(args, "tune_reps", 5));
+        return 0;
+    }
+
+    if (args.variant == "pipelined") {
+        auto system = make_system();
+        jacobi_pipelined_benchmark(N, target_accuracy, max_iters, device, system.first, system.second, get_option(args, "interval", 0), get_option(args, "overlap", 1) != 0);
+        return 0;
+    }
+
+    std::vector<std::string> dense_variants = {"dense", "accessors", "shared", "device", "group", "native"};
+    if (std::find(dense_variants.begin(), dense_variants.end(), args.variant) == dense_variants.end()) {
+        std::cout << "Variant error" << std::endl;
+        exit(-1);
+    }
+    bool all = args.variant == "dense";
+
+    auto system = make_system();
+    if (args.options.count("save")) {
+        write_system_file(args.options.at("save"), system.first, system.second, Layout::ColMajor);
+    }
+    std::vector<float> res_accessors, res_shared_mem, res_device_mem, res_group;
+    bool profile = get_option(args, "profile", 0) != 0;
+    if (all || args.variant == "accessors") {
+        res_accessors = jacobi_accessors(N, target_accuracy, max_iters, device, system.first, system.second, profile);
+    }
+    if (all || args.variant == "shared") {
+        res_shared_mem = jacobi_shared_mem(N, target_accuracy, max_iters, device, system.first, system.second, profile);
+    }
+    if (all || args.variant == "device") {
+        res_device_mem = jacobi_device_mem(N, target_accuracy, max_iters, device, system.first, system.second, profile);
+    }
+    if (all || args.variant == "group") {
+        int group_size = get_option(args, "wg", 256);
+        int tile_size = get_option(args, "tile", 1024);
+        res_group = jacobi_group(N, target_accuracy, max_iters, device, system.first, system.second, group_size, tile_size);
+    }
+    if (all || args.variant == "native") {
+        jacobi_native(N, target_accuracy, max_iters, system.first, system.second, get_option(args, "threads", 0));
+    }
+    if (all) {
+        assert(res_accessors == res_shared_mem);
+        assert(res_accessors == res_device_mem);
+    }
 
     // for (int i = 0; i < N; i++) {
     //     for (int j = 0; j < N; j++) {